@@ -0,0 +1,119 @@
+// Compares the spatial_hash broadphase against brute force O(n^2) pair testing.
+// Usage: broadphase_bench [--brute-force-limit N]  (skips brute force above N entities for quicker runs;
+// by default every count is checked against it)
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include "spatial_hash.h"
+
+namespace
+{
+    using bench_clock = std::chrono::steady_clock;
+
+    double elapsed_ms(bench_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(bench_clock::now() - start).count();
+    }
+
+    // Slime-sized boxes at a constant density, so the cost per entity is comparable across counts.
+    std::vector<aabb> make_boxes(size_t count, aabb& world)
+    {
+        const float side = std::sqrt(static_cast<float>(count)) * 96.0f;
+        world = { { 0.0f, 0.0f }, { side, side } };
+        std::mt19937 rng(42);
+        std::uniform_real_distribution<float> coord(0.0f, side);
+        std::uniform_real_distribution<float> size(16.0f, 64.0f);
+        std::vector<aabb> boxes(count);
+        for (aabb& box : boxes)
+        {
+            const glm::vec2 center = { coord(rng), coord(rng) };
+            const glm::vec2 half = glm::vec2(size(rng), size(rng)) * 0.5f;
+            box = { center - half, center + half };
+        }
+        return boxes;
+    }
+
+    size_t brute_force_pairs(const std::vector<aabb>& boxes)
+    {
+        size_t pairs = 0;
+        for (size_t i = 0; i < boxes.size(); i++)
+        {
+            for (size_t j = i + 1; j < boxes.size(); j++)
+            {
+                pairs += overlaps(boxes[i], boxes[j]);
+            }
+        }
+        return pairs;
+    }
+}
+
+int main(int argc, const char* const* argv)
+{
+    size_t brute_force_limit = 100'000;
+    for (int i = 1; i + 1 < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--brute-force-limit") == 0)
+        {
+            brute_force_limit = std::min<size_t>(brute_force_limit, std::stoul(argv[i + 1]));
+        }
+    }
+
+    constexpr int iterations = 20;
+    std::printf("%10s %14s %14s %14s %14s %12s\n", "entities", "rebuild ms", "pairs ms", "radius q/ms", "brute ms", "pairs");
+    for (size_t count : { 1'000, 10'000, 100'000 })
+    {
+        aabb world;
+        const std::vector<aabb> boxes = make_boxes(count, world);
+        spatial_hash grid(world, 64.0f);
+
+        // Warm up so the timed iterations measure the allocation-free steady state.
+        grid.rebuild(boxes);
+        size_t pairs = 0;
+        auto start = bench_clock::now();
+        for (int i = 0; i < iterations; i++)
+        {
+            grid.rebuild(boxes);
+        }
+        const double rebuild_ms = elapsed_ms(start) / iterations;
+
+        start = bench_clock::now();
+        for (int i = 0; i < iterations; i++)
+        {
+            pairs = 0;
+            grid.for_each_pair_batch([&pairs](std::span<const box_pair> batch) { pairs += batch.size(); });
+        }
+        const double pairs_ms = elapsed_ms(start) / iterations;
+
+        std::vector<uint32_t> hits;
+        hits.reserve(count);
+        constexpr int queries = 10'000;
+        start = bench_clock::now();
+        for (int i = 0; i < queries; i++)
+        {
+            hits.clear();
+            grid.query_radius(boxes[i % count].min, 100.0f, hits);
+        }
+        const double queries_per_ms = queries / elapsed_ms(start);
+
+        double brute_ms = -1.0;
+        if (count <= brute_force_limit)
+        {
+            start = bench_clock::now();
+            const size_t expected = brute_force_pairs(boxes);
+            brute_ms = elapsed_ms(start);
+            if (expected != pairs)
+            {
+                std::printf("MISMATCH: grid found %zu pairs, brute force %zu\n", pairs, expected);
+                return 1;
+            }
+        }
+
+        std::printf("%10zu %14.3f %14.3f %14.1f %14.3f %12zu\n", count, rebuild_ms, pairs_ms, queries_per_ms, brute_ms, pairs);
+    }
+    return 0;
+}
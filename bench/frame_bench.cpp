@@ -0,0 +1,149 @@
+// Runs a fixed set of scripted scenes headless and writes a JSON frame-time report.
+// Usage: frame_bench [--render] [--seconds K] [--out report.json] [--baseline old.json [--tolerance 0.15]]
+//   --render    also run the scenes with sprite rendering, one of them with shader hot reload polling
+//               (needs a GL 4.6 context, e.g. llvmpipe under xvfb-run)
+//   --baseline  exits with 1 when any scene's p99 frame time is more than `tolerance` slower than in the baseline
+// Also exits with 1 when any scene calls operator new after warming up: steady-state frames must not allocate.
+// Build with TRACY_ENABLE=OFF for CI: without a connected profiler Tracy keeps every zone in memory.
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "benchmark.h"
+
+namespace
+{
+    // Reads the p99 frame time of `scene` back out of a report written by write_benchmark_json().
+    bool find_baseline_p99(const std::string& report, const std::string& scene, double& p99)
+    {
+        const size_t name = report.find("\"name\": \"" + scene + "\"");
+        if (name == std::string::npos)
+        {
+            return false;
+        }
+        const size_t frame = report.find("\"frame_ms\"", name);
+        const size_t value = frame == std::string::npos ? frame : report.find("\"p99\": ", frame);
+        if (value == std::string::npos)
+        {
+            return false;
+        }
+        p99 = std::strtod(report.c_str() + value + 7, nullptr);
+        return true;
+    }
+}
+
+int main(int argc, const char* const* argv)
+{
+    bool render = false;
+    double seconds = 10.0;
+    double tolerance = 0.15;
+    std::string out_path;
+    std::string baseline_path;
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        if (arg == "--render")
+        {
+            render = true;
+        }
+        else if (arg == "--seconds" && has_value)
+        {
+            seconds = std::stod(argv[++i]);
+        }
+        else if (arg == "--out" && has_value)
+        {
+            out_path = argv[++i];
+        }
+        else if (arg == "--baseline" && has_value)
+        {
+            baseline_path = argv[++i];
+        }
+        else if (arg == "--tolerance" && has_value)
+        {
+            tolerance = std::stod(argv[++i]);
+        }
+    }
+
+    // Smallest first: peak memory is a process-wide high-water mark, so each scene reports its own peak.
+    std::vector<benchmark_scene> scenes = {
+        { "sim_1k", 1'000, 0, seconds, false },
+        { "sim_10k", 10'000, 0, seconds, false },
+        { "sim_100k", 100'000, 0, seconds, false },
+    };
+    if (render)
+    {
+        scenes.push_back({ "render_1k", 1'000, 0, seconds, true });
+        scenes.push_back({ "render_10k", 10'000, 4'000, seconds, true });
+        scenes.push_back({ "render_100k", 100'000, 32'000, seconds, true });
+        // The game polls shader sources every frame while hot reload is on; that must not allocate either.
+        benchmark_scene reload = scenes[scenes.size() - 2];
+        reload.name = "render_10k_reload";
+        reload.hot_reload = true;
+        scenes.push_back(reload);
+    }
+
+    std::vector<benchmark_result> results;
+    for (const benchmark_scene& scene : scenes)
+    {
+        results.push_back(run_benchmark(scene));
+        const benchmark_result& r = results.back();
+        std::fprintf(stderr, "%-12s frame p50 %7.3f  p95 %7.3f  p99 %7.3f ms  (update p50 %7.3f, render p50 %7.3f)\n",
+            scene.name.c_str(), r.frame.p50_ms, r.frame.p95_ms, r.frame.p99_ms, r.update.p50_ms, r.render.p50_ms);
+    }
+
+    if (out_path.empty())
+    {
+        write_benchmark_json(std::cout, results);
+    }
+    else
+    {
+        std::ofstream out(out_path);
+        if (!out)
+        {
+            throw std::runtime_error("Failed to open " + out_path);
+        }
+        write_benchmark_json(out, results);
+    }
+
+    int failures = 0;
+    for (const benchmark_result& r : results)
+    {
+        if (r.heap_allocations > 0)
+        {
+            std::fprintf(stderr, "ALLOCATIONS %s: %llu heap allocations in %u steady-state frames\n", r.scene.name.c_str(),
+                static_cast<unsigned long long>(r.heap_allocations), r.frames);
+            failures++;
+        }
+    }
+
+    if (baseline_path.empty())
+    {
+        return failures > 0 ? 1 : 0;
+    }
+    std::ifstream baseline_file(baseline_path);
+    if (!baseline_file)
+    {
+        throw std::runtime_error("Failed to open " + baseline_path);
+    }
+    std::stringstream baseline;
+    baseline << baseline_file.rdbuf();
+    for (const benchmark_result& r : results)
+    {
+        double previous = 0.0;
+        if (!find_baseline_p99(baseline.str(), r.scene.name, previous) || previous <= 0.0)
+        {
+            continue;
+        }
+        if (r.frame.p99_ms > previous * (1.0 + tolerance))
+        {
+            std::fprintf(stderr, "REGRESSION %s: p99 frame time %.3f ms, baseline %.3f ms\n", r.scene.name.c_str(), r.frame.p99_ms, previous);
+            failures++;
+        }
+    }
+    return failures > 0 ? 1 : 0;
+}
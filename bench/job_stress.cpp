@@ -0,0 +1,96 @@
+// Stress test for job dependencies: chains of short jobs on counters that live on the stack and
+// are destroyed as soon as their waiter returns, the pattern that races with workers releasing
+// dependent jobs. Chains are started from inside jobs, so many of them are in flight at once.
+// Build with -fsanitize=address (and detect_stack_use_after_return=1) or thread to catch misuse.
+// Usage: job_stress [--chains N] [--threads N]  (default 20000 chains on every hardware thread)
+// Exits with 1 when a job starts before the stage it depends on has finished.
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include "job_system.h"
+
+namespace
+{
+    constexpr size_t stages = 4;
+    constexpr size_t jobs_per_stage = 8;
+
+    struct chain
+    {
+        std::atomic<uint32_t> finished[stages] = {};
+        std::atomic<uint32_t> violations{ 0 };
+    };
+
+    struct stage_job
+    {
+        chain* state;
+        size_t stage;
+    };
+
+    void run_stage(void* context, size_t, size_t)
+    {
+        const stage_job& j = *static_cast<const stage_job*>(context);
+        if (j.stage > 0 && j.state->finished[j.stage - 1].load(std::memory_order_acquire) != jobs_per_stage)
+        {
+            j.state->violations.fetch_add(1, std::memory_order_relaxed);
+        }
+        j.state->finished[j.stage].fetch_add(1, std::memory_order_release);
+    }
+
+    // Everything lives in this frame, so the counters are destroyed right after the waits return.
+    uint32_t run_chain(job_system& jobs)
+    {
+        chain state;
+        stage_job contexts[stages];
+        job_counter counters[stages];
+        for (size_t s = 0; s < stages; s++)
+        {
+            contexts[s] = { &state, s };
+            for (size_t i = 0; i < jobs_per_stage; i++)
+            {
+                jobs.submit({ run_stage, &contexts[s], i, i + 1 }, counters[s], s > 0 ? &counters[s - 1] : nullptr);
+            }
+        }
+        for (size_t s = stages; s-- > 0;)
+        {
+            jobs.wait(counters[s]);
+        }
+        return state.violations.load();
+    }
+}
+
+int main(int argc, const char* const* argv)
+{
+    size_t chains = 20'000;
+    unsigned threads = std::max(std::thread::hardware_concurrency(), 2u);
+    for (int i = 1; i + 1 < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--chains") == 0)
+        {
+            chains = std::stoul(argv[i + 1]);
+        }
+        else if (std::strcmp(argv[i], "--threads") == 0)
+        {
+            threads = static_cast<unsigned>(std::stoul(argv[i + 1]));
+        }
+    }
+
+    job_system jobs(threads);
+    const auto start = std::chrono::steady_clock::now();
+    std::atomic<uint64_t> violations{ 0 };
+    jobs.parallel_for(chains, 1, [&](size_t, size_t)
+    {
+        violations.fetch_add(run_chain(jobs), std::memory_order_relaxed);
+    });
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::printf("%zu chains of %zu x %zu jobs on %u workers in %.1f ms\n", chains, stages, jobs_per_stage, jobs.worker_count(), ms);
+    if (violations > 0)
+    {
+        std::printf("MISMATCH: %llu jobs started before their dependency finished\n", static_cast<unsigned long long>(violations.load()));
+        return 1;
+    }
+    return 0;
+}
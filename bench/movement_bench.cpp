@@ -0,0 +1,161 @@
+// Compares the movement kernels against a plain glm loop over an array of structs.
+// Usage: movement_bench [--entities N]  (runs 1k, 10k, 100k and 1M entities when N isn't given)
+// Everything runs on one thread; the simulation spreads the same kernels over the job system.
+// Exits with 1 when a kernel ends up with different positions than the glm loop.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include "movement_kernels.h"
+
+namespace
+{
+    using bench_clock = std::chrono::steady_clock;
+
+    double elapsed_ms(bench_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(bench_clock::now() - start).count();
+    }
+
+    // The layout movement would naturally get without components: one struct per entity.
+    struct slime
+    {
+        glm::vec2 position;
+        glm::vec2 velocity;
+        glm::vec2 scale;
+    };
+
+    void move_glm(std::vector<slime>& slimes, const movement_params& params)
+    {
+        const float pull_scale = params.acceleration * params.dt;
+        for (slime& s : slimes)
+        {
+            const glm::vec2 d = params.target - s.position;
+            const float distance2 = glm::dot(d, d);
+            if (distance2 > 0.0f)
+            {
+                s.velocity += d * (1.0f / std::sqrt(distance2) * pull_scale);
+            }
+            const float speed2 = glm::dot(s.velocity, s.velocity);
+            if (speed2 > params.max_speed * params.max_speed)
+            {
+                s.velocity *= params.max_speed / std::sqrt(speed2);
+            }
+            s.position += s.velocity * params.dt;
+            const glm::vec2 half = s.scale * 0.5f;
+            for (int axis = 0; axis < 2; axis++)
+            {
+                if (s.position[axis] - half[axis] < params.bounds.min[axis])
+                {
+                    s.position[axis] = params.bounds.min[axis] + half[axis];
+                    s.velocity[axis] = std::abs(s.velocity[axis]);
+                }
+                else if (s.position[axis] + half[axis] > params.bounds.max[axis])
+                {
+                    s.position[axis] = params.bounds.max[axis] - half[axis];
+                    s.velocity[axis] = -std::abs(s.velocity[axis]);
+                }
+            }
+        }
+    }
+
+    // Component columns as the registry stores them.
+    struct columns
+    {
+        std::vector<glm::vec2> positions;
+        std::vector<glm::vec2> velocities;
+        std::vector<glm::vec2> scales;
+
+        movement_batch batch()
+        {
+            return { static_cast<uint32_t>(positions.size()), &positions[0].x, &velocities[0].x, &scales[0].x };
+        }
+    };
+}
+
+int main(int argc, const char* const* argv)
+{
+    std::vector<size_t> counts = { 1'000, 10'000, 100'000, 1'000'000 };
+    for (int i = 1; i + 1 < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--entities") == 0)
+        {
+            counts = { std::stoul(argv[i + 1]) };
+        }
+    }
+
+    // Same world and steering as the game: slimes drift toward the player in the middle of the screen.
+    movement_params params;
+    params.dt = 1.0f / 120.0f;
+    params.bounds = { { 0.0f, 0.0f }, { 1920.0f, 1080.0f } };
+    params.target = { 960.0f, 540.0f };
+    params.acceleration = 40.0f;
+    params.max_speed = 120.0f;
+
+    const simd_level best = detect_simd_level();
+    std::printf("best supported: %s\n", simd_level_name(best));
+    std::printf("%10s %10s %16s %10s\n", "entities", "kernel", "entities/ms", "speedup");
+    for (size_t count : counts)
+    {
+        std::mt19937 rng(1337);
+        std::uniform_real_distribution<float> x(0.0f, 1920.0f);
+        std::uniform_real_distribution<float> y(0.0f, 1080.0f);
+        std::uniform_real_distribution<float> speed(-80.0f, 80.0f);
+        std::vector<slime> initial(count);
+        for (slime& s : initial)
+        {
+            s = { { x(rng), y(rng) }, { speed(rng), speed(rng) }, { 64.0f, 64.0f } };
+        }
+        // Roughly 20M entity updates per measurement, and always several ticks.
+        const int ticks = static_cast<int>(std::max<size_t>(8, 20'000'000 / count));
+
+        std::vector<slime> reference = initial;
+        auto start = bench_clock::now();
+        for (int t = 0; t < ticks; t++)
+        {
+            move_glm(reference, params);
+        }
+        const double glm_rate = static_cast<double>(count) * ticks / elapsed_ms(start);
+        std::printf("%10zu %10s %16.0f %10.2f\n", count, "glm", glm_rate, 1.0);
+
+        for (simd_level level : { simd_level::scalar, simd_level::sse2, simd_level::avx2 })
+        {
+            if (level > best)
+            {
+                continue;
+            }
+            columns data;
+            for (const slime& s : initial)
+            {
+                data.positions.push_back(s.position);
+                data.velocities.push_back(s.velocity);
+                data.scales.push_back(s.scale);
+            }
+            const movement_kernel move = select_movement_kernel(level);
+            const movement_batch batch = data.batch();
+            start = bench_clock::now();
+            for (int t = 0; t < ticks; t++)
+            {
+                move(batch, params);
+            }
+            const double rate = static_cast<double>(count) * ticks / elapsed_ms(start);
+
+            float max_error = 0.0f;
+            for (size_t i = 0; i < count; i++)
+            {
+                max_error = std::max({ max_error, std::abs(data.positions[i].x - reference[i].position.x), std::abs(data.positions[i].y - reference[i].position.y) });
+            }
+            std::printf("%10zu %10s %16.0f %10.2f\n", count, simd_level_name(level), rate, rate / glm_rate);
+            if (max_error > 1e-2f)
+            {
+                std::printf("MISMATCH: %s is off by up to %g units after %d ticks\n", simd_level_name(level), max_error, ticks);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,406 @@
+// Compares loading a level from the binary scene format against the same level stored as JSON.
+// Usage: scene_bench [--entities N] [--dir D]  (default 1000000 slimes; the level files are written to D, default .)
+// The binary load maps the file and copies whole columns into entity chunks. The JSON baseline reads
+// the file and parses it the way a text level format would, creating entities one at a time.
+// Both files were just written, so both loads read from a warm page cache. "resident" is what the
+// loaded level keeps; "peak" is how far the load pushed the process high-water mark, which catches
+// temporaries such as the JSON text but only counts growth beyond earlier loads, so loads run smallest first.
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "benchmark.h"
+#include "entity.h"
+#include "hash.h"
+#include "memory.h"
+#include "scene.h"
+#include "scene_file.h"
+
+namespace
+{
+    using bench_clock = std::chrono::steady_clock;
+
+    double elapsed_ms(bench_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(bench_clock::now() - start).count();
+    }
+
+    constexpr uint32_t map_tiles = 256;
+    constexpr float tile_size = 64.0f;
+    const std::vector<std::string> asset_names = { "Sprite-0002", "red_wizard" };
+
+    // Stands in for texture_atlas::find(): handles are indices into asset_names.
+    sprite_handle resolve(std::string_view name)
+    {
+        for (size_t i = 0; i < asset_names.size(); i++)
+        {
+            if (asset_names[i] == name)
+            {
+                return static_cast<sprite_handle>(i);
+            }
+        }
+        throw std::runtime_error("Unknown asset " + std::string(name));
+    }
+
+    // What a loaded level consists of without a GL context: the entities and the terrain tiles.
+    struct level
+    {
+        entity_registry registry;
+        std::vector<sprite_handle> tiles;
+    };
+
+    // Hash of every component and tile, to check that each format loads the same level.
+    uint64_t fingerprint(level& l)
+    {
+        uint64_t hash = fnv1a_seed;
+        l.registry.each_chunk<position, previous_position, scale, sprite>(with<player_tag>{},
+            [&hash](uint32_t count, const entity_handle*, const position* p, const previous_position* prev, const scale* s, const sprite* t)
+        {
+            hash = fnv1a64(p, sizeof(*p) * count, hash);
+            hash = fnv1a64(prev, sizeof(*prev) * count, hash);
+            hash = fnv1a64(s, sizeof(*s) * count, hash);
+            hash = fnv1a64(t, sizeof(*t) * count, hash);
+        });
+        l.registry.each_chunk<position, previous_position, velocity, scale, sprite>(with<slime_tag>{},
+            [&hash](uint32_t count, const entity_handle*, const position* p, const previous_position* prev, const velocity* v, const scale* s, const sprite* t)
+        {
+            hash = fnv1a64(p, sizeof(*p) * count, hash);
+            hash = fnv1a64(prev, sizeof(*prev) * count, hash);
+            hash = fnv1a64(v, sizeof(*v) * count, hash);
+            hash = fnv1a64(s, sizeof(*s) * count, hash);
+            hash = fnv1a64(t, sizeof(*t) * count, hash);
+        });
+        return fnv1a64(l.tiles.data(), sizeof(sprite_handle) * l.tiles.size(), hash);
+    }
+
+    void write_json(const std::filesystem::path& path, level& l)
+    {
+        std::ofstream out(path);
+        if (!out)
+        {
+            throw std::runtime_error("Failed to open " + path.string());
+        }
+        // Enough digits for every float to read back exactly.
+        out.precision(9);
+        out << "{\n  \"assets\": [";
+        for (size_t i = 0; i < asset_names.size(); i++)
+        {
+            out << (i ? ", " : "") << '"' << asset_names[i] << '"';
+        }
+        out << "],\n  \"terrain\": { \"width\": " << map_tiles << ", \"height\": " << map_tiles << ", \"tile_size\": " << tile_size << ", \"tiles\": [";
+        for (size_t i = 0; i < l.tiles.size(); i++)
+        {
+            out << (i ? "," : "") << (l.tiles[i] == scene_empty_tile ? -1 : static_cast<int64_t>(l.tiles[i]));
+        }
+        out << "] },\n  \"entities\": [\n";
+        bool first = true;
+        auto write_entity = [&](const char* kind, const position& p, const velocity* v, const scale& s, const sprite& t)
+        {
+            out << (first ? "" : ",\n") << "    { \"kind\": \"" << kind << "\", \"position\": [" << p.value.x << ", " << p.value.y << "]";
+            if (v)
+            {
+                out << ", \"velocity\": [" << v->value.x << ", " << v->value.y << "]";
+            }
+            out << ", \"scale\": [" << s.value.x << ", " << s.value.y << "], \"sprite\": " << t.handle << ", \"clip_start\": " << t.clip_start
+                << ", \"clip_speed\": " << t.clip_speed << " }";
+            first = false;
+        };
+        l.registry.each<position, scale, sprite>(with<player_tag>{}, [&](const position& p, const scale& s, const sprite& t)
+        {
+            write_entity("player", p, nullptr, s, t);
+        });
+        l.registry.each<position, velocity, scale, sprite>(with<slime_tag>{}, [&](const position& p, const velocity& v, const scale& s, const sprite& t)
+        {
+            write_entity("slime", p, &v, s, t);
+        });
+        out << "\n  ]\n}\n";
+    }
+
+    // Just enough of a JSON reader for the files write_json() produces, in any key order.
+    class json_reader
+    {
+    public:
+        explicit json_reader(const char* text) : at_(text) {}
+
+        void expect(char c)
+        {
+            skip_space();
+            if (*at_ != c)
+            {
+                throw std::runtime_error(std::string("JSON: expected '") + c + "'");
+            }
+            at_++;
+        }
+
+        // Consumes `c` if it is next.
+        bool next(char c)
+        {
+            skip_space();
+            if (*at_ == c)
+            {
+                at_++;
+                return true;
+            }
+            return false;
+        }
+
+        std::string_view string()
+        {
+            expect('"');
+            const char* begin = at_;
+            while (*at_ && *at_ != '"')
+            {
+                at_++;
+            }
+            const std::string_view text(begin, static_cast<size_t>(at_ - begin));
+            expect('"');
+            return text;
+        }
+
+        float number()
+        {
+            skip_space();
+            char* end = nullptr;
+            const float value = std::strtof(at_, &end);
+            if (end == at_)
+            {
+                throw std::runtime_error("JSON: expected a number");
+            }
+            at_ = end;
+            return value;
+        }
+
+        glm::vec2 vec2()
+        {
+            expect('[');
+            glm::vec2 value;
+            value.x = number();
+            expect(',');
+            value.y = number();
+            expect(']');
+            return value;
+        }
+
+    private:
+        void skip_space()
+        {
+            while (*at_ == ' ' || *at_ == '\n' || *at_ == '\r' || *at_ == '\t')
+            {
+                at_++;
+            }
+        }
+
+        const char* at_;
+    };
+
+    void load_json(const std::filesystem::path& path, level& l)
+    {
+        std::ifstream file(path, std::ios::binary);
+        const std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        json_reader in(text.c_str());
+        std::vector<sprite_handle> handles; // by asset index
+        in.expect('{');
+        do
+        {
+            const std::string_view key = in.string();
+            in.expect(':');
+            if (key == "assets")
+            {
+                in.expect('[');
+                while (!in.next(']'))
+                {
+                    handles.push_back(resolve(in.string()));
+                    in.next(',');
+                }
+            }
+            else if (key == "terrain")
+            {
+                in.expect('{');
+                do
+                {
+                    const std::string_view field = in.string();
+                    in.expect(':');
+                    if (field == "tiles")
+                    {
+                        in.expect('[');
+                        while (!in.next(']'))
+                        {
+                            const float tile = in.number();
+                            l.tiles.push_back(tile < 0.0f ? scene_empty_tile : handles.at(static_cast<size_t>(tile)));
+                            in.next(',');
+                        }
+                    }
+                    else
+                    {
+                        in.number();
+                    }
+                } while (in.next(','));
+                in.expect('}');
+            }
+            else if (key == "entities")
+            {
+                in.expect('[');
+                while (!in.next(']'))
+                {
+                    std::string_view kind;
+                    position p = {};
+                    velocity v = {};
+                    scale s = {};
+                    sprite t = {};
+                    in.expect('{');
+                    do
+                    {
+                        const std::string_view field = in.string();
+                        in.expect(':');
+                        if (field == "kind")
+                        {
+                            kind = in.string();
+                        }
+                        else if (field == "position")
+                        {
+                            p.value = in.vec2();
+                        }
+                        else if (field == "velocity")
+                        {
+                            v.value = in.vec2();
+                        }
+                        else if (field == "scale")
+                        {
+                            s.value = in.vec2();
+                        }
+                        else if (field == "sprite")
+                        {
+                            t.handle = handles.at(static_cast<size_t>(in.number()));
+                        }
+                        else if (field == "clip_start")
+                        {
+                            t.clip_start = in.number();
+                        }
+                        else if (field == "clip_speed")
+                        {
+                            t.clip_speed = in.number();
+                        }
+                        else
+                        {
+                            throw std::runtime_error("JSON: unknown entity field");
+                        }
+                    } while (in.next(','));
+                    in.expect('}');
+                    if (kind == "player")
+                    {
+                        l.registry.create(p, previous_position{ p.value }, s, t, player_tag{});
+                    }
+                    else
+                    {
+                        l.registry.create(p, previous_position{ p.value }, v, s, t, slime_tag{});
+                    }
+                    in.next(',');
+                }
+            }
+        } while (in.next(','));
+        in.expect('}');
+    }
+
+    void load_binary(const std::filesystem::path& path, level& l, bool verify_checksum)
+    {
+        const scene_file file(path, verify_checksum);
+        std::vector<sprite_handle> handles(file.asset_count());
+        for (uint32_t i = 0; i < file.asset_count(); i++)
+        {
+            handles[i] = resolve(file.asset_name(i));
+        }
+        file.instantiate(l.registry, handles);
+
+        const scene_file_header& h = file.header();
+        l.tiles.assign(static_cast<size_t>(h.map_width) * h.map_height, scene_empty_tile);
+        for (uint32_t y = 0; y < h.map_height; y++)
+        {
+            for (uint32_t x = 0; x < h.map_width; x++)
+            {
+                const uint32_t asset = file.tile_chunk(x / h.chunk_size, y / h.chunk_size)[(y % h.chunk_size) * h.chunk_size + x % h.chunk_size];
+                if (asset != scene_empty_tile)
+                {
+                    l.tiles[static_cast<size_t>(y) * h.map_width + x] = handles.at(asset);
+                }
+            }
+        }
+    }
+}
+
+int main(int argc, const char* const* argv)
+{
+    int entities = 1'000'000;
+    std::filesystem::path dir = ".";
+    for (int i = 1; i + 1 < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--entities") == 0)
+        {
+            entities = std::stoi(argv[i + 1]);
+        }
+        else if (std::strcmp(argv[i], "--dir") == 0)
+        {
+            dir = argv[i + 1];
+        }
+    }
+    const std::filesystem::path binary_path = dir / "scene_bench.scene";
+    const std::filesystem::path json_path = dir / "scene_bench.json";
+
+    uint64_t expected = 0;
+    {
+        level source;
+        create_player_entity(source.registry, 0, 960.0f, 540.0f);
+        std::vector<entity_handle> slimes;
+        spawn_stress_slimes(source.registry, slimes, 1, entities, { { 0.0f, 0.0f }, { map_tiles * tile_size, map_tiles * tile_size } });
+        // Half the map, on a checkerboard like fill_terrain().
+        source.tiles.assign(static_cast<size_t>(map_tiles) * map_tiles, scene_empty_tile);
+        for (uint32_t y = 0; y < map_tiles; y++)
+        {
+            for (uint32_t x = y % 2; x < map_tiles; x += 2)
+            {
+                source.tiles[static_cast<size_t>(y) * map_tiles + x] = 0;
+            }
+        }
+        expected = fingerprint(source);
+
+        auto start = bench_clock::now();
+        export_scene(binary_path, source.registry, { map_tiles, map_tiles, tile_size, source.tiles }, asset_names);
+        std::printf("export binary: %.1f ms, %.1f MiB\n", elapsed_ms(start), std::filesystem::file_size(binary_path) / 1048576.0);
+        start = bench_clock::now();
+        write_json(json_path, source);
+        std::printf("export json:   %.1f ms, %.1f MiB\n", elapsed_ms(start), std::filesystem::file_size(json_path) / 1048576.0);
+    }
+
+    std::printf("%-22s %12s %14s %14s %14s\n", "load", "ms", "allocations", "resident MiB", "peak MiB");
+    auto measure = [&](const char* name, auto&& load)
+    {
+        level loaded;
+        const size_t resident_before = resident_memory_bytes();
+        const size_t peak_before = peak_memory_bytes();
+        const uint64_t allocations_before = heap_allocation_count();
+        const auto start = bench_clock::now();
+        load(loaded);
+        const double ms = elapsed_ms(start);
+        const uint64_t allocations = heap_allocation_count() - allocations_before;
+        const size_t resident_after = resident_memory_bytes();
+        const size_t peak_after = peak_memory_bytes();
+        const double resident_mib = (resident_after > resident_before ? resident_after - resident_before : 0) / 1048576.0;
+        const double peak_mib = (peak_after > peak_before ? peak_after - peak_before : 0) / 1048576.0;
+        if (fingerprint(loaded) != expected)
+        {
+            std::printf("MISMATCH: %s loaded a different level\n", name);
+            std::exit(1);
+        }
+        std::printf("%-22s %12.1f %14llu %14.1f %14.1f\n", name, ms, static_cast<unsigned long long>(allocations), resident_mib, peak_mib);
+    };
+    measure("binary", [&](level& l) { load_binary(binary_path, l, true); });
+    measure("binary, no checksum", [&](level& l) { load_binary(binary_path, l, false); });
+    measure("json", [&](level& l) { load_json(json_path, l); });
+    return 0;
+}
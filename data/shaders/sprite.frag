@@ -0,0 +1,13 @@
+#version 430 core
+out vec4 FragColor;
+
+in vec3 ourColor;
+in vec2 TexCoord;
+flat in uint Layer;
+
+uniform sampler2DArray ourTexture;
+
+void main()
+{
+   FragColor = texture(ourTexture, vec3(TexCoord, Layer));
+}
@@ -0,0 +1,28 @@
+#version 430 core
+layout (location = 0) in vec2 aPos;
+layout (location = 1) in vec3 aColor;
+layout (location = 2) in vec2 aTexCoord;
+#include "sprite_instance.glsl"
+#include "sprite_clips.glsl"
+
+out vec3 ourColor;
+out vec2 TexCoord;
+flat out uint Layer;
+uniform mat4 projection;
+uniform float time; // seconds
+
+void main()
+{
+   gl_Position = projection * vec4(aPos * instanceScale + instancePosition, 0.0, 1.0);
+   ourColor = aColor;
+   vec4 uv = instanceUv;
+   uint layer = instanceLayer;
+   if (instanceClip != NO_CLIP)
+   {
+      uint frame = clipFrameAt(instanceClip, (time - instanceClipStart) * instanceClipSpeed);
+      uv = clipFrames[frame].uv;
+      layer = clipFrames[frame].layer;
+   }
+   TexCoord = mix(uv.xy, uv.zw, aTexCoord);
+   Layer = layer;
+}
@@ -0,0 +1,36 @@
+// Animation tables uploaded by texture_atlas. Must match atlas_clip and atlas_frame in texture_atlas.h.
+const uint NO_CLIP = 0xFFFFFFFFu;
+
+struct Clip
+{
+    uint firstFrame;
+    uint frameCount;
+    float duration;
+    uint padding;
+};
+
+struct ClipFrame
+{
+    vec4 uv;
+    uint layer;
+    float end;
+    uint padding0;
+    uint padding1;
+};
+
+layout (std430, binding = 0) readonly buffer Clips { Clip clips[]; };
+layout (std430, binding = 1) readonly buffer ClipFrames { ClipFrame clipFrames[]; };
+
+// Frame of `clip` shown `t` seconds after it started, looping.
+uint clipFrameAt(uint clip, float t)
+{
+    Clip c = clips[clip];
+    float local = mod(t, c.duration);
+    uint frame = c.firstFrame;
+    uint last = c.firstFrame + c.frameCount - 1u;
+    while (frame < last && clipFrames[frame].end <= local)
+    {
+        frame++;
+    }
+    return frame;
+}
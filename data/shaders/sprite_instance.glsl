@@ -0,0 +1,8 @@
+// Per-instance attributes. Must match sprite_instance in sprite_batch.h.
+layout (location = 3) in vec2 instancePosition;
+layout (location = 4) in vec2 instanceScale;
+layout (location = 5) in vec4 instanceUv;
+layout (location = 6) in uint instanceLayer;
+layout (location = 7) in uint instanceClip;
+layout (location = 8) in float instanceClipStart;
+layout (location = 9) in float instanceClipSpeed;
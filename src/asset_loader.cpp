@@ -0,0 +1,210 @@
+#include "asset_loader.h"
+#include <tracy/Tracy.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+    // Big enough for one row of a 16k wide RGBA8 texture, so every upload can make progress.
+    constexpr size_t min_upload_budget = 64 * 1024;
+
+    GLuint create_placeholder()
+    {
+        // 2x2 magenta/black checker: obviously not final art, but never an incomplete texture.
+        const unsigned char pixels[] = {
+            255, 0, 255, 255,   0, 0, 0, 255,
+            0, 0, 0, 255,       255, 0, 255, 255,
+        };
+        GLuint texture = 0;
+        glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &texture);
+        glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTextureStorage3D(texture, 1, GL_RGBA8, 2, 2, 1);
+        glTextureSubImage3D(texture, 0, 0, 0, 0, 2, 2, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+        return texture;
+    }
+
+    void wait_for_fence(GLsync& fence)
+    {
+        if (!fence)
+        {
+            return;
+        }
+        ZoneScopedN("asset_loader wait");
+        GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        while (result == GL_TIMEOUT_EXPIRED)
+        {
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1'000'000);
+        }
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+}
+
+asset_loader::asset_loader(unsigned worker_count, size_t upload_budget)
+    : budget_(std::max(upload_budget, min_upload_budget)), workers_(std::max(worker_count, 1u), "asset worker")
+{
+    placeholder_ = create_placeholder();
+
+    // One budget-sized region per frame in flight, like the sprite instance ring.
+    const auto size = static_cast<GLsizeiptr>(budget_ * frames_in_flight);
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glCreateBuffers(1, &pbo_);
+    glNamedBufferStorage(pbo_, size, nullptr, flags);
+    mapped_ = static_cast<unsigned char*>(glMapNamedBufferRange(pbo_, 0, size, flags));
+    if (!mapped_)
+    {
+        throw std::runtime_error("Failed to map texture upload buffer");
+    }
+}
+
+asset_loader::~asset_loader()
+{
+    for (GLsync& fence : fences_)
+    {
+        if (fence)
+        {
+            glDeleteSync(fence);
+        }
+    }
+    for (const texture_request& request : requests_)
+    {
+        glDeleteTextures(1, &request.texture);
+    }
+    glDeleteTextures(1, &placeholder_);
+    glUnmapNamedBuffer(pbo_);
+    glDeleteBuffers(1, &pbo_);
+}
+
+texture_handle asset_loader::load_texture_array(std::function<texture_data()> decode)
+{
+    return add_request(workers_.submit(std::move(decode)));
+}
+
+texture_handle asset_loader::add_request(std::future<texture_data> decoding)
+{
+    const auto handle = static_cast<texture_handle>(requests_.size());
+    texture_request& request = requests_.emplace_back();
+    request.decoding = std::move(decoding);
+    pending_.push_back(handle);
+    return handle;
+}
+
+GLuint asset_loader::texture(texture_handle handle) const
+{
+    const texture_request& request = requests_[handle];
+    if (request.resident && request.texture != 0)
+    {
+        return request.texture;
+    }
+    return placeholder_;
+}
+
+void asset_loader::begin_upload(texture_request& request)
+{
+    request.data = request.decoding.get();
+    request.uploading = true;
+    const texture_data& data = request.data;
+    if (data.levels.empty())
+    {
+        return; // failed to decode; keeps showing the placeholder
+    }
+
+    glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &request.texture);
+    glTextureParameteri(request.texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(request.texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(request.texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTextureParameteri(request.texture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTextureParameteri(request.texture, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(data.levels.size()) - 1);
+
+    const auto levels = static_cast<GLsizei>(data.levels.size());
+    const auto width = static_cast<GLsizei>(data.width);
+    const auto height = static_cast<GLsizei>(data.height);
+    glTextureStorage3D(request.texture, levels, GL_RGBA8, width, height, static_cast<GLsizei>(data.layers));
+}
+
+bool asset_loader::upload_rows(texture_request& request, size_t& used)
+{
+    const texture_data& data = request.data;
+    while (request.level < data.levels.size())
+    {
+        const uint32_t width = data.level_width(request.level);
+        const uint32_t height = data.level_height(request.level);
+        const size_t row_bytes = static_cast<size_t>(width) * 4;
+        while (request.layer < data.layers)
+        {
+            const auto rows = static_cast<uint32_t>(std::min<size_t>(height - request.row, (budget_ - used) / row_bytes));
+            if (rows == 0)
+            {
+                return false;
+            }
+            const size_t source_offset = (static_cast<size_t>(request.layer) * height + request.row) * row_bytes;
+            const size_t buffer_offset = static_cast<size_t>(region_) * budget_ + used;
+            std::memcpy(mapped_ + buffer_offset, data.levels[request.level].data() + source_offset, rows * row_bytes);
+
+            // With a pixel unpack buffer bound, the pointer argument is an offset into it.
+            const auto* offset = reinterpret_cast<const void*>(buffer_offset);
+            const auto level = static_cast<GLint>(request.level);
+            glTextureSubImage3D(request.texture, level, 0, static_cast<GLint>(request.row), static_cast<GLint>(request.layer),
+                static_cast<GLsizei>(width), static_cast<GLsizei>(rows), 1, GL_RGBA, GL_UNSIGNED_BYTE, offset);
+
+            used += rows * row_bytes;
+            request.row += rows;
+            if (request.row == height)
+            {
+                request.row = 0;
+                request.layer++;
+            }
+        }
+        request.layer = 0;
+        request.level++;
+    }
+    return true;
+}
+
+void asset_loader::update()
+{
+    uploaded_bytes_ = 0;
+    if (pending_.empty())
+    {
+        return;
+    }
+    ZoneScopedN("texture upload");
+
+    wait_for_fence(fences_[region_]);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo_);
+
+    size_t used = 0;
+    for (auto it = pending_.begin(); it != pending_.end() && used < budget_;)
+    {
+        texture_request& request = requests_[*it];
+        if (!request.uploading)
+        {
+            // Later requests may finish decoding first; don't let one slow image hold them back.
+            if (request.decoding.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            {
+                ++it;
+                continue;
+            }
+            begin_upload(request);
+        }
+        if (!upload_rows(request, used))
+        {
+            break;
+        }
+        request.resident = true;
+        request.data = {};
+        it = pending_.erase(it);
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    if (used > 0)
+    {
+        fences_[region_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        region_ = (region_ + 1) % frames_in_flight;
+    }
+    uploaded_bytes_ = used;
+    TracyPlot("texture upload bytes", static_cast<int64_t>(used));
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <glad/gl.h>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <vector>
+#include "texture_data.h"
+#include "thread_pool.h"
+
+using texture_handle = uint32_t;
+
+// Loads array textures without blocking the render thread. Decoding runs on a pool of worker threads;
+// finished images are streamed to the GPU through a persistently mapped pixel buffer, at most
+// `upload_budget` bytes per frame. Until a texture is resident, texture() returns a placeholder.
+class asset_loader
+{
+public:
+    static constexpr uint32_t frames_in_flight = 3;
+
+    asset_loader(unsigned worker_count, size_t upload_budget);
+    ~asset_loader();
+
+    asset_loader(const asset_loader&) = delete;
+    asset_loader& operator=(const asset_loader&) = delete;
+
+    // Runs `decode` on a worker; the result is uploaded as GL_TEXTURE_2D_ARRAY.
+    texture_handle load_texture_array(std::function<texture_data()> decode);
+
+    GLuint texture(texture_handle handle) const;
+    bool resident(texture_handle handle) const { return requests_[handle].resident; }
+    bool idle() const { return pending_.empty(); }
+
+    // Call once per frame on the render thread. Starts uploads for finished decodes within the budget.
+    void update();
+    // Bytes copied into the upload buffer by the last update().
+    size_t uploaded_bytes() const { return uploaded_bytes_; }
+
+    thread_pool& workers() { return workers_; }
+
+private:
+    struct texture_request
+    {
+        std::future<texture_data> decoding;
+        texture_data data;
+        GLuint texture = 0;
+        bool uploading = false;
+        bool resident = false;
+        // Upload cursor: next rows to copy.
+        uint32_t level = 0;
+        uint32_t layer = 0;
+        uint32_t row = 0;
+    };
+
+    texture_handle add_request(std::future<texture_data> decoding);
+    void begin_upload(texture_request& request);
+    // Copies as many rows as fit into the remaining budget. Returns true once the texture is complete.
+    bool upload_rows(texture_request& request, size_t& used);
+
+    std::vector<texture_request> requests_;
+    std::vector<texture_handle> pending_; // not yet resident, in submission order
+
+    GLuint placeholder_ = 0;
+
+    size_t budget_ = 0;
+    size_t uploaded_bytes_ = 0;
+    GLuint pbo_ = 0;
+    unsigned char* mapped_ = nullptr;
+    uint32_t region_ = 0;
+    GLsync fences_[frames_in_flight] = {};
+
+    // Declared last so the workers are joined before anything they could touch is destroyed.
+    thread_pool workers_;
+};
@@ -0,0 +1,361 @@
+#include "benchmark.h"
+#include <tracy/Tracy.hpp>
+#include <glad/gl.h>
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "asset_loader.h"
+#include "camera.h"
+#include "entity.h"
+#include "gl_state.h"
+#include "gpu_timers.h"
+#include "job_system.h"
+#include "memory.h"
+#include "render_queue.h"
+#include "scene.h"
+#include "shader_manager.h"
+#include "simulation.h"
+#include "sprite_batch.h"
+#include "sprite_pipeline.h"
+#include "texture_atlas.h"
+#include "tilemap.h"
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+#if defined(__APPLE__)
+#include <mach/mach.h>
+#endif
+#endif
+
+namespace
+{
+    using bench_clock = std::chrono::steady_clock;
+
+    // Frames run before measuring starts, so caches, buffers and the job system are warm.
+    constexpr uint32_t warmup_frames = 30;
+    // Much larger than the view, so terrain scenes also measure chunk culling.
+    constexpr uint32_t map_tiles = 256;
+    constexpr float tile_size = 64.0f;
+
+    double elapsed_ms(bench_clock::time_point start, bench_clock::time_point end)
+    {
+        return std::chrono::duration<double, std::milli>(end - start).count();
+    }
+
+    // Nearest-rank percentiles.
+    timing_summary summarize(std::vector<double>& samples)
+    {
+        if (samples.empty())
+        {
+            return {};
+        }
+        std::sort(samples.begin(), samples.end());
+        auto percentile = [&samples](double p)
+        {
+            const auto rank = static_cast<size_t>(std::ceil(p / 100.0 * static_cast<double>(samples.size())));
+            return samples[std::clamp<size_t>(rank, 1, samples.size()) - 1];
+        };
+        double total = 0.0;
+        for (double sample : samples)
+        {
+            total += sample;
+        }
+        return { total / static_cast<double>(samples.size()), percentile(50), percentile(95), percentile(99), samples.back() };
+    }
+
+    // Everything needed to draw, owned together so it is torn down before the context.
+    struct render_context
+    {
+        GLFWwindow* window = nullptr;
+        std::optional<shader_manager> shaders;
+        sprite_pipeline pipeline;
+        std::optional<asset_loader> assets;
+        std::optional<texture_atlas> atlas;
+        std::optional<sprite_batch> sprites;
+        std::optional<tilemap> terrain;
+        std::optional<gpu_timers> timers;
+        std::optional<render_queue> queue;
+        gl_state state;
+
+        explicit render_context(const benchmark_scene& scene)
+        {
+            if (!glfwInit())
+            {
+                throw std::runtime_error("Failed to initialize GLFW; rendering benchmarks need a display (try xvfb-run)");
+            }
+            glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+            glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+            glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+            glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+            window = glfwCreateWindow(scene.width, scene.height, "benchmark", nullptr, nullptr);
+            if (!window)
+            {
+                glfwTerminate();
+                throw std::runtime_error("Failed to create benchmark window");
+            }
+            glfwMakeContextCurrent(window);
+            glfwSwapInterval(0);
+            if (gladLoadGL(glfwGetProcAddress) == 0)
+            {
+                glfwTerminate();
+                throw std::runtime_error("Failed to initialize OpenGL");
+            }
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+            shaders.emplace("shaders", "shader_cache", scene.hot_reload);
+            pipeline = create_sprite_pipeline(*shaders);
+            assets.emplace(std::max(std::thread::hardware_concurrency(), 2u) - 1, 4 << 20);
+            atlas.emplace(*assets, "models", "atlas.cache");
+            sprites.emplace(pipeline.vao, sprite_batch::default_capacity);
+            terrain.emplace(pipeline, map_tiles, map_tiles, tile_size);
+            timers.emplace();
+            queue.emplace();
+
+            // Streaming isn't what is being measured, so wait until the atlas is on the GPU.
+            const double deadline = glfwGetTime() + 60.0;
+            while (!atlas->resident() || !assets->idle())
+            {
+                if (glfwGetTime() > deadline)
+                {
+                    throw std::runtime_error("Timed out waiting for the sprite atlas");
+                }
+                assets->update();
+                atlas->update();
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+
+        ~render_context()
+        {
+            queue.reset();
+            timers.reset();
+            terrain.reset();
+            sprites.reset();
+            atlas.reset();
+            assets.reset();
+            destroy_sprite_pipeline(pipeline);
+            shaders.reset();
+            glfwTerminate();
+        }
+
+        render_context(const render_context&) = delete;
+        render_context& operator=(const render_context&) = delete;
+    };
+}
+
+benchmark_result run_benchmark(const benchmark_scene& scene)
+{
+    ZoneScoped;
+    std::optional<render_context> gpu;
+    sprite_handle slime_sprite = 0;
+    if (scene.render)
+    {
+        gpu.emplace(scene);
+        slime_sprite = gpu->atlas->find("red_wizard");
+        fill_terrain(*gpu->terrain, gpu->atlas->find("Sprite-0002"), static_cast<uint32_t>(scene.terrain));
+    }
+
+    const aabb world = { { 0.0f, 0.0f }, { static_cast<float>(scene.width), static_cast<float>(scene.height) } };
+    entity_registry registry;
+    std::vector<entity_handle> slimes;
+    spawn_stress_slimes(registry, slimes, slime_sprite, scene.slimes, world);
+
+    job_system jobs(std::max(std::thread::hardware_concurrency(), 1u));
+    frame_memory memory;
+    simulation sim(jobs, memory, world);
+    const camera cam = { world.max * 0.5f, world.max };
+    const glm::mat4 projection = view_projection(cam);
+
+    const auto frames = static_cast<uint32_t>(std::llround(scene.seconds * simulation::tick_rate));
+    std::vector<double> frame_ms, update_ms, render_ms, gpu_ms;
+    frame_ms.reserve(frames);
+    update_ms.reserve(frames);
+    render_ms.reserve(frames);
+    gpu_ms.reserve(frames);
+    uint32_t draw_calls = 0;
+    uint64_t heap_allocations = 0;
+
+    for (uint32_t frame = 0; frame < warmup_frames + frames; frame++)
+    {
+        const uint64_t allocations_before = heap_allocation_count();
+        const auto start = bench_clock::now();
+        memory.begin_frame();
+        if (gpu)
+        {
+            gpu->assets->update();
+            gpu->atlas->update();
+            if (gpu->shaders->reload_changed())
+            {
+                gpu->state.invalidate();
+            }
+        }
+        const float alpha = sim.advance(registry, simulation::tick_seconds);
+        const auto updated = bench_clock::now();
+
+        if (gpu)
+        {
+            glClearColor(1.0f, 0.0f, 0.5f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
+            const GLuint program = gpu->shaders->program(gpu->pipeline.program);
+            gpu->queue->begin();
+            gpu->state.set_uniform(program, gpu->shaders->uniform(gpu->pipeline.program, "projection"), projection);
+            // Simulated rather than wall-clock time, so every run shows the same animation frames.
+            gpu->state.set_uniform(program, gpu->shaders->uniform(gpu->pipeline.program, "time"), static_cast<float>(sim.ticks() * simulation::tick_seconds));
+            gpu->atlas->bind_clips(gpu->state);
+            gpu->terrain->draw(*gpu->queue, program, *gpu->atlas, view_rect(cam));
+            gpu->sprites->begin();
+            registry.each_chunk<position, previous_position, scale, sprite>([&](uint32_t count, const entity_handle*, position* p, previous_position* prev, scale* s, sprite* t)
+            {
+                const std::span<sprite_instance> instances = gpu->sprites->allocate(gpu->atlas->texture(), count);
+                write_sprite_instances(*gpu->atlas, alpha, static_cast<uint32_t>(instances.size()), p, prev, s, t, instances.data());
+            });
+            gpu->sprites->flush(*gpu->queue, program);
+            gpu->timers->begin(gpu_pass::scene);
+            gpu->queue->execute(gpu->state, render_layer::terrain, render_layer::sprites);
+            draw_calls = gpu->queue->stats().draw_calls;
+            gpu->timers->end(gpu_pass::scene);
+            glfwSwapBuffers(gpu->window);
+            gpu->timers->collect();
+        }
+        const auto rendered = bench_clock::now();
+        const uint64_t allocations_after = heap_allocation_count();
+        FrameMark;
+
+        if (frame >= warmup_frames)
+        {
+            heap_allocations += allocations_after - allocations_before;
+            frame_ms.push_back(elapsed_ms(start, rendered));
+            update_ms.push_back(elapsed_ms(start, updated));
+            render_ms.push_back(elapsed_ms(updated, rendered));
+            if (gpu)
+            {
+                gpu_ms.push_back(gpu->timers->milliseconds(gpu_pass::scene));
+            }
+        }
+    }
+
+    benchmark_result result = {};
+    result.scene = scene;
+    result.threads = jobs.worker_count();
+    result.frames = frames;
+    result.frame = summarize(frame_ms);
+    result.update = summarize(update_ms);
+    result.render = scene.render ? summarize(render_ms) : timing_summary{};
+    result.gpu = summarize(gpu_ms);
+    result.draw_calls = draw_calls;
+    result.heap_allocations = heap_allocations;
+    result.frame_arena_bytes = std::max(memory.current().stats().high_water, memory.previous().stats().high_water);
+    result.peak_memory_bytes = peak_memory_bytes();
+    return result;
+}
+
+namespace
+{
+    void write_timing(std::ostream& out, const char* name, const timing_summary& timing)
+    {
+        out << "      \"" << name << "\": { \"mean\": " << timing.mean_ms << ", \"p50\": " << timing.p50_ms << ", \"p95\": " << timing.p95_ms
+            << ", \"p99\": " << timing.p99_ms << ", \"max\": " << timing.max_ms << " },\n";
+    }
+}
+
+void write_benchmark_json(std::ostream& out, std::span<const benchmark_result> results)
+{
+    const auto flags = out.flags();
+    const auto precision = out.precision();
+    out.setf(std::ios::fixed, std::ios::floatfield);
+    out.precision(4);
+
+    out << "{\n  \"scenes\": [\n";
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const benchmark_result& r = results[i];
+        // Scene names come from the benchmark code, never from input, so they need no escaping.
+        out << "    {\n";
+        out << "      \"name\": \"" << r.scene.name << "\",\n";
+        out << "      \"slimes\": " << r.scene.slimes << ",\n";
+        out << "      \"terrain\": " << r.scene.terrain << ",\n";
+        out << "      \"seconds\": " << r.scene.seconds << ",\n";
+        out << "      \"render\": " << (r.scene.render ? "true" : "false") << ",\n";
+        out << "      \"hot_reload\": " << (r.scene.hot_reload ? "true" : "false") << ",\n";
+        out << "      \"threads\": " << r.threads << ",\n";
+        out << "      \"frames\": " << r.frames << ",\n";
+        write_timing(out, "frame_ms", r.frame);
+        write_timing(out, "update_ms", r.update);
+        write_timing(out, "render_ms", r.render);
+        write_timing(out, "gpu_ms", r.gpu);
+        out << "      \"draw_calls\": " << r.draw_calls << ",\n";
+        out << "      \"heap_allocations\": " << r.heap_allocations << ",\n";
+        out << "      \"frame_arena_bytes\": " << r.frame_arena_bytes << ",\n";
+        out << "      \"peak_memory_bytes\": " << r.peak_memory_bytes << "\n";
+        out << "    }" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+
+    out.flags(flags);
+    out.precision(precision);
+}
+
+size_t peak_memory_bytes()
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters = {};
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    {
+        return counters.PeakWorkingSetSize;
+    }
+    return 0;
+#else
+    rusage usage = {};
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+    {
+        return 0;
+    }
+#if defined(__APPLE__)
+    return static_cast<size_t>(usage.ru_maxrss); // bytes on macOS
+#else
+    return static_cast<size_t>(usage.ru_maxrss) * 1024; // kilobytes on Linux
+#endif
+#endif
+}
+
+size_t resident_memory_bytes()
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters = {};
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    {
+        return counters.WorkingSetSize;
+    }
+    return 0;
+#elif defined(__APPLE__)
+    mach_task_basic_info info = {};
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info), &count) != KERN_SUCCESS)
+    {
+        return 0;
+    }
+    return static_cast<size_t>(info.resident_size);
+#else
+    // Second field: resident pages.
+    std::ifstream statm("/proc/self/statm");
+    size_t total_pages = 0;
+    size_t resident_pages = 0;
+    if (!(statm >> total_pages >> resident_pages))
+    {
+        return 0;
+    }
+    return resident_pages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <span>
+#include <string>
+
+// A scripted, reproducible scene. Every frame advances the simulation by exactly one tick, so the
+// amount of work depends only on the scene and not on how fast the machine is.
+struct benchmark_scene
+{
+    std::string name;
+    int slimes = 0;
+    int terrain = 0; // tilemap tiles; static terrain only costs anything when rendering
+    double seconds = 10.0; // simulated time
+    // Without rendering no window or GL context is created at all. With it, sprites are drawn into a
+    // hidden window with vsync off; on machines without a GPU that means a software driver such as
+    // Mesa llvmpipe, and on machines without a display an X server such as xvfb-run.
+    bool render = false;
+    int width = 1920;
+    int height = 1080;
+    // Polls the shader sources every frame like the game does with hot reload on. Needs render.
+    bool hot_reload = false;
+};
+
+struct timing_summary
+{
+    double mean_ms;
+    double p50_ms;
+    double p95_ms;
+    double p99_ms;
+    double max_ms;
+};
+
+struct benchmark_result
+{
+    benchmark_scene scene;
+    unsigned threads;
+    uint32_t frames;
+    timing_summary frame;
+    timing_summary update; // simulation and asset streaming
+    timing_summary render; // batching, submission and swap; zero when not rendering
+    timing_summary gpu;    // GPU time of the scene pass; zero when not rendering or built without the perf overlay
+    uint32_t draw_calls;   // in the last frame
+    uint64_t heap_allocations; // operator new calls during the measured frames; steady state should need none
+    size_t frame_arena_bytes;  // most frame arena memory any frame used
+    size_t peak_memory_bytes; // high-water mark of the whole process so far
+};
+
+benchmark_result run_benchmark(const benchmark_scene& scene);
+void write_benchmark_json(std::ostream& out, std::span<const benchmark_result> results);
+
+// Peak resident set size of the process, or 0 where the platform doesn't report it.
+size_t peak_memory_bytes();
+// Current resident set size of the process, or 0 where the platform doesn't report it.
+size_t resident_memory_bytes();
@@ -0,0 +1,39 @@
+#pragma once
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <type_traits>
+
+// Helpers for the binary cache files. Values are written in native byte order; caches are never
+// shared between machines.
+template<typename T>
+void write_pod(std::ostream& out, const T& value)
+{
+    static_assert(std::is_trivially_copyable_v<T>);
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template<typename T>
+bool read_pod(std::istream& in, T& value)
+{
+    static_assert(std::is_trivially_copyable_v<T>);
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+inline void write_string(std::ostream& out, const std::string& text)
+{
+    write_pod(out, static_cast<uint32_t>(text.size()));
+    out.write(text.data(), static_cast<std::streamsize>(text.size()));
+}
+
+inline bool read_string(std::istream& in, std::string& text)
+{
+    uint32_t size = 0;
+    if (!read_pod(in, size) || size > 4096)
+    {
+        return false;
+    }
+    text.resize(size);
+    return static_cast<bool>(in.read(text.data(), size));
+}
@@ -0,0 +1,19 @@
+#include "camera.h"
+#include <glm/gtc/matrix_transform.hpp>
+
+aabb view_rect(const camera& cam)
+{
+    const glm::vec2 half = cam.viewport * (0.5f / cam.zoom);
+    return { cam.center - half, cam.center + half };
+}
+
+glm::mat4 view_projection(const camera& cam)
+{
+    const aabb view = view_rect(cam);
+    return glm::ortho(view.min.x, view.max.x, view.max.y, view.min.y, -1.0f, 1.0f);
+}
+
+glm::vec2 screen_to_world(const camera& cam, glm::vec2 screen)
+{
+    return cam.center + (screen - cam.viewport * 0.5f) / cam.zoom;
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include <glm/glm.hpp>
+#include "spatial_hash.h"
+
+// 2D orthographic camera. Screen y points down, like the window coordinates ImGui and GLFW use.
+struct camera
+{
+    glm::vec2 center;   // world position shown in the middle of the viewport
+    glm::vec2 viewport; // framebuffer size in pixels
+    float zoom = 1.0f;  // pixels per world unit
+};
+
+// World-space rectangle the camera sees.
+aabb view_rect(const camera& cam);
+glm::mat4 view_projection(const camera& cam);
+glm::vec2 screen_to_world(const camera& cam, glm::vec2 screen);
@@ -0,0 +1,22 @@
+#include "entity.h"
+
+entity_handle create_player_entity(entity_registry& registry, sprite_handle image, float x, float y)
+{
+    return registry.create(position{ { x, y } }, previous_position{ { x, y } }, scale{ { 128, 128 } }, sprite{ image }, player_tag{});
+}
+
+entity_handle create_slime_entity(entity_registry& registry, const sprite& image, float x, float y, glm::vec2 speed)
+{
+    return registry.create(position{ { x, y } }, previous_position{ { x, y } }, velocity{ speed }, scale{ { 64, 64 } }, image, slime_tag{});
+}
+
+void write_sprite_instances(const texture_atlas& atlas, float alpha, uint32_t count, const position* current, const previous_position* previous,
+    const scale* scales, const sprite* sprites, sprite_instance* out)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const atlas_region& region = atlas.region(sprites[i].handle);
+        out[i] = { glm::mix(previous[i].value, current[i].value, alpha), scales[i].value, region.uv, region.layer, region.clip,
+            sprites[i].clip_start, sprites[i].clip_speed };
+    }
+}
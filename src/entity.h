@@ -0,0 +1,47 @@
+#pragma once
+#include <glm/glm.hpp>
+#include "entity_registry.h"
+#include "sprite_batch.h"
+#include "texture_atlas.h"
+
+// Components. Data components get their own column per archetype; empty tags only select the archetype.
+struct position
+{
+    glm::vec2 value;
+};
+
+// Position at the previous simulation tick, used to interpolate between ticks when rendering.
+struct previous_position
+{
+    glm::vec2 value;
+};
+
+// Units per second.
+struct velocity
+{
+    glm::vec2 value;
+};
+
+struct scale
+{
+    glm::vec2 value;
+};
+
+struct sprite
+{
+    sprite_handle handle;
+    // Only used by animated sprites: see sprite_instance::clip_start and clip_speed.
+    float clip_start = 0.0f;
+    float clip_speed = 1.0f;
+};
+
+struct player_tag {};
+struct slime_tag {};
+
+entity_handle create_player_entity(entity_registry& registry, sprite_handle image, float x, float y);
+entity_handle create_slime_entity(entity_registry& registry, const sprite& image, float x, float y, glm::vec2 speed);
+
+// Writes one instance per entity to `out`, e.g. memory from sprite_batch::allocate(). Each sprite is
+// drawn `alpha` of the way from its position at the previous simulation tick to the current one.
+void write_sprite_instances(const texture_atlas& atlas, float alpha, uint32_t count, const position* current, const previous_position* previous,
+    const scale* scales, const sprite* sprites, sprite_instance* out);
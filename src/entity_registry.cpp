@@ -0,0 +1,137 @@
+#include "entity_registry.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+    size_t align_up(size_t value, size_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+}
+
+uint32_t detail::next_component_id()
+{
+    static uint32_t next = 0;
+    if (next == max_component_types)
+    {
+        throw std::runtime_error("Too many component types");
+    }
+    return next++;
+}
+
+archetype::archetype(component_mask mask, std::vector<column_info> columns, archetype_chunk_pool& chunk_pool)
+    : chunk_pool_(chunk_pool), mask_(mask)
+{
+    std::fill(std::begin(column_of_), std::end(column_of_), int8_t{ -1 });
+
+    // Every row stores its handle plus one element per column; reserve worst-case padding between columns.
+    size_t row_bytes = sizeof(entity_handle);
+    for (const column_info& column : columns)
+    {
+        row_bytes += column.size;
+    }
+    const size_t padding = column_alignment * (columns.size() + 1);
+    if (padding + row_bytes > chunk_bytes)
+    {
+        throw std::runtime_error("Components don't fit in an archetype chunk");
+    }
+    chunk_capacity_ = static_cast<uint32_t>((chunk_bytes - padding) / row_bytes);
+
+    size_t offset = align_up(sizeof(entity_handle) * chunk_capacity_, column_alignment);
+    for (const column_info& column : columns)
+    {
+        column_of_[column.component] = static_cast<int8_t>(columns_.size());
+        columns_.push_back({ column.component, column.size, offset });
+        offset = align_up(offset + static_cast<size_t>(column.size) * chunk_capacity_, column_alignment);
+    }
+}
+
+archetype::~archetype()
+{
+    for (std::byte* chunk : chunks_)
+    {
+        chunk_pool_.deallocate(reinterpret_cast<archetype_chunk*>(chunk));
+    }
+}
+
+uint32_t archetype::push(entity_handle handle)
+{
+    const uint32_t row = count_++;
+    if (row / chunk_capacity_ == chunks_.size())
+    {
+        chunks_.push_back(chunk_pool_.allocate()->bytes);
+    }
+    handles(row / chunk_capacity_)[row % chunk_capacity_] = handle;
+    return row;
+}
+
+entity_handle archetype::swap_remove(uint32_t row)
+{
+    const uint32_t last = --count_;
+    if (row == last)
+    {
+        return null_entity;
+    }
+    for (const column_layout& column : columns_)
+    {
+        std::memcpy(row_address(column, row), row_address(column, last), column.size);
+    }
+    const entity_handle moved = handles(last / chunk_capacity_)[last % chunk_capacity_];
+    handles(row / chunk_capacity_)[row % chunk_capacity_] = moved;
+    return moved;
+}
+
+entity_handle entity_registry::allocate_handle()
+{
+    if (!free_slots_.empty())
+    {
+        const uint32_t index = free_slots_.back();
+        free_slots_.pop_back();
+        return { index, slots_[index].generation };
+    }
+    slots_.push_back({ 0, dead_archetype, 0 });
+    return { static_cast<uint32_t>(slots_.size() - 1), 0 };
+}
+
+bool entity_registry::alive(entity_handle handle) const
+{
+    return handle.index < slots_.size() && slots_[handle.index].generation == handle.generation &&
+        slots_[handle.index].archetype != dead_archetype;
+}
+
+void entity_registry::destroy(entity_handle handle)
+{
+    if (!alive(handle))
+    {
+        return;
+    }
+    slot& s = slots_[handle.index];
+    const entity_handle moved = archetypes_[s.archetype]->swap_remove(s.row);
+    if (moved != null_entity)
+    {
+        slots_[moved.index].row = s.row;
+    }
+    s.generation++;
+    s.archetype = dead_archetype;
+    free_slots_.push_back(handle.index);
+    alive_--;
+}
+
+void entity_registry::clear()
+{
+    for (auto& arch : archetypes_)
+    {
+        arch->clear();
+    }
+    for (uint32_t i = 0; i < slots_.size(); i++)
+    {
+        if (slots_[i].archetype != dead_archetype)
+        {
+            slots_[i].generation++;
+            slots_[i].archetype = dead_archetype;
+            free_slots_.push_back(i);
+        }
+    }
+    alive_ = 0;
+}
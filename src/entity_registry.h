@@ -0,0 +1,328 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <unordered_map>
+#include <vector>
+#include "memory.h"
+
+// Stable reference to an entity. The generation is bumped every time an index is recycled,
+// so handles to destroyed entities are detected instead of silently aliasing a new entity.
+struct entity_handle
+{
+    uint32_t index;
+    uint32_t generation;
+
+    bool operator==(const entity_handle&) const = default;
+};
+
+constexpr entity_handle null_entity = { UINT32_MAX, 0 };
+
+using component_mask = uint64_t;
+constexpr uint32_t max_component_types = 64;
+
+namespace detail
+{
+    uint32_t next_component_id();
+}
+
+// Small dense id per component type, assigned on first use.
+template<typename T>
+uint32_t component_id()
+{
+    static const uint32_t id = detail::next_component_id();
+    return id;
+}
+
+template<typename... Ts>
+component_mask mask_of()
+{
+    return (component_mask{ 0 } | ... | (component_mask{ 1 } << component_id<Ts>()));
+}
+
+// Tag filter for queries: components that must be present but are not passed to the callback.
+template<typename... Ts>
+struct with {};
+
+// Storage for one archetype chunk. The chunks of every archetype come from a pool owned by the registry.
+struct alignas(16) archetype_chunk
+{
+    std::byte bytes[16 * 1024];
+};
+
+using archetype_chunk_pool = pool<archetype_chunk>;
+
+// All entities with exactly the same set of components. Components are stored as one array per
+// component type (structure of arrays), split into fixed-size chunks so growing never moves data.
+class archetype
+{
+public:
+    static constexpr size_t chunk_bytes = sizeof(archetype_chunk);
+    static constexpr size_t column_alignment = alignof(archetype_chunk);
+
+    struct column_info
+    {
+        uint32_t component;
+        uint32_t size;
+    };
+
+    archetype(component_mask mask, std::vector<column_info> columns, archetype_chunk_pool& chunk_pool);
+    ~archetype();
+
+    archetype(const archetype&) = delete;
+    archetype& operator=(const archetype&) = delete;
+
+    component_mask mask() const { return mask_; }
+    uint32_t size() const { return count_; }
+    uint32_t chunk_capacity() const { return chunk_capacity_; }
+    size_t chunk_count() const { return chunks_.size(); }
+
+    // Number of live rows in the given chunk.
+    uint32_t chunk_size(size_t chunk) const
+    {
+        const size_t begin = chunk * chunk_capacity_;
+        if (begin >= count_)
+        {
+            return 0;
+        }
+        return static_cast<uint32_t>(count_ - begin < chunk_capacity_ ? count_ - begin : chunk_capacity_);
+    }
+
+    bool has_column(uint32_t component) const { return column_of_[component] >= 0; }
+
+    template<typename T>
+    T* column(size_t chunk)
+    {
+        const int col = column_of_[component_id<T>()];
+        return reinterpret_cast<T*>(chunks_[chunk] + columns_[col].offset);
+    }
+
+    entity_handle* handles(size_t chunk) { return reinterpret_cast<entity_handle*>(chunks_[chunk]); }
+
+    template<typename T>
+    T* get(uint32_t row)
+    {
+        return column<T>(row / chunk_capacity_) + row % chunk_capacity_;
+    }
+
+    // Appends an uninitialized row and returns its index.
+    uint32_t push(entity_handle handle);
+    // Moves the last row into `row`. Returns the handle of the entity that moved, or null_entity.
+    entity_handle swap_remove(uint32_t row);
+
+    void clear() { count_ = 0; }
+
+private:
+    struct column_layout
+    {
+        uint32_t component;
+        uint32_t size;
+        size_t offset; // byte offset of the column inside a chunk
+    };
+
+    std::byte* row_address(const column_layout& column, uint32_t row)
+    {
+        return chunks_[row / chunk_capacity_] + column.offset + static_cast<size_t>(column.size) * (row % chunk_capacity_);
+    }
+
+    archetype_chunk_pool& chunk_pool_;
+    component_mask mask_;
+    std::vector<column_layout> columns_;
+    int8_t column_of_[max_component_types];
+    uint32_t chunk_capacity_ = 0;
+    uint32_t count_ = 0;
+    std::vector<std::byte*> chunks_;
+};
+
+// Owns every entity and its components. Entities are grouped by archetype, so a query only visits
+// archetypes that contain all requested components and never has to branch on entity kind.
+class entity_registry
+{
+public:
+    entity_registry() = default;
+    entity_registry(const entity_registry&) = delete;
+    entity_registry& operator=(const entity_registry&) = delete;
+
+    template<typename... Ts>
+    entity_handle create(const Ts&... components)
+    {
+        static_assert((std::is_trivially_copyable_v<Ts> && ...), "components are moved with memcpy");
+        const uint32_t arch_index = archetype_for<Ts...>();
+        archetype& arch = *archetypes_[arch_index];
+        const entity_handle handle = allocate_handle();
+        const uint32_t row = arch.push(handle);
+        slots_[handle.index].archetype = arch_index;
+        slots_[handle.index].row = row;
+        (write_component(arch, row, components), ...);
+        alive_++;
+        return handle;
+    }
+
+    // Creates `count` entities holding Ts and Tags without copying components one entity at a time:
+    // fill(first, n, Ts*... columns) is called once per chunk touched and must initialize the n rows
+    // behind each column pointer, which are entities first to first + n - 1 of this batch.
+    template<typename... Ts, typename... Tags, typename F>
+    void create_many(with<Tags...>, uint32_t count, F&& fill)
+    {
+        static_assert((std::is_trivially_copyable_v<Ts> && ...), "components are moved with memcpy");
+        static_assert(!(std::is_empty_v<Ts> || ...), "tags have no column; pass them in with<>");
+        const uint32_t arch_index = archetype_for<Ts..., Tags...>();
+        archetype& arch = *archetypes_[arch_index];
+        if (count > free_slots_.size())
+        {
+            slots_.reserve(slots_.size() + count - free_slots_.size());
+        }
+        for (uint32_t first = 0; first < count;)
+        {
+            const uint32_t start_row = arch.size();
+            const uint32_t n = std::min(count - first, arch.chunk_capacity() - start_row % arch.chunk_capacity());
+            for (uint32_t i = 0; i < n; i++)
+            {
+                const entity_handle handle = allocate_handle();
+                const uint32_t row = arch.push(handle);
+                slots_[handle.index].archetype = arch_index;
+                slots_[handle.index].row = row;
+            }
+            const size_t chunk = start_row / arch.chunk_capacity();
+            const uint32_t offset = start_row % arch.chunk_capacity();
+            fill(first, n, (arch.template column<Ts>(chunk) + offset)...);
+            first += n;
+        }
+        alive_ += count;
+    }
+
+    void destroy(entity_handle handle);
+    bool alive(entity_handle handle) const;
+    size_t size() const { return alive_; }
+    void clear();
+
+    const allocation_stats& chunk_stats() const { return chunk_pool_.stats(); }
+
+    // Returns nullptr if the entity is dead or has no such component.
+    template<typename T>
+    T* get(entity_handle handle)
+    {
+        if (!alive(handle))
+        {
+            return nullptr;
+        }
+        const slot& s = slots_[handle.index];
+        archetype& arch = *archetypes_[s.archetype];
+        if (!arch.has_column(component_id<T>()))
+        {
+            return nullptr;
+        }
+        return arch.get<T>(s.row);
+    }
+
+    // Calls f(count, handles, Ts*...) once per chunk holding all of Ts and Tags.
+    template<typename... Ts, typename... Tags, typename F>
+    void each_chunk(with<Tags...>, F&& f)
+    {
+        static_assert(!(std::is_empty_v<Ts> || ...), "tags have no column; pass them in with<>");
+        const component_mask query = mask_of<Ts..., Tags...>();
+        for (const auto& arch : archetypes_)
+        {
+            if ((arch->mask() & query) != query || arch->size() == 0)
+            {
+                continue;
+            }
+            for (size_t chunk = 0; chunk < arch->chunk_count(); chunk++)
+            {
+                const uint32_t count = arch->chunk_size(chunk);
+                if (count == 0)
+                {
+                    break;
+                }
+                f(count, arch->handles(chunk), arch->template column<Ts>(chunk)...);
+            }
+        }
+    }
+
+    template<typename... Ts, typename F>
+    void each_chunk(F&& f)
+    {
+        each_chunk<Ts...>(with<>{}, std::forward<F>(f));
+    }
+
+    // Calls f(Ts&...) for every entity holding all of Ts and Tags.
+    template<typename... Ts, typename... Tags, typename F>
+    void each(with<Tags...> tags, F&& f)
+    {
+        each_chunk<Ts...>(tags, [&f](uint32_t count, const entity_handle*, Ts*... columns)
+        {
+            for (uint32_t i = 0; i < count; i++)
+            {
+                f(columns[i]...);
+            }
+        });
+    }
+
+    template<typename... Ts, typename F>
+    void each(F&& f)
+    {
+        each<Ts...>(with<>{}, std::forward<F>(f));
+    }
+
+private:
+    static constexpr uint32_t dead_archetype = UINT32_MAX;
+
+    struct slot
+    {
+        uint32_t generation;
+        uint32_t archetype;
+        uint32_t row;
+    };
+
+    template<typename T>
+    static void write_component(archetype& arch, uint32_t row, const T& component)
+    {
+        if constexpr (!std::is_empty_v<T>)
+        {
+            std::memcpy(arch.get<T>(row), &component, sizeof(T));
+        }
+    }
+
+    template<typename... Ts>
+    uint32_t archetype_for()
+    {
+        // Same sizes the archetype constructor adds up; at least one row must fit in a chunk.
+        constexpr size_t row_bytes = sizeof(entity_handle) + (size_t{ 0 } + ... + (std::is_empty_v<Ts> ? 0 : sizeof(Ts)));
+        constexpr size_t column_count = (size_t{ 0 } + ... + (std::is_empty_v<Ts> ? 0 : 1));
+        static_assert(archetype::column_alignment * (column_count + 1) + row_bytes <= archetype::chunk_bytes, "components don't fit in an archetype chunk");
+        const component_mask mask = mask_of<Ts...>();
+        if (auto it = archetype_lookup_.find(mask); it != archetype_lookup_.end())
+        {
+            return it->second;
+        }
+        std::vector<archetype::column_info> columns;
+        auto add_column = [&columns]<typename T>(T*)
+        {
+            if constexpr (!std::is_empty_v<T>)
+            {
+                static_assert(alignof(T) <= archetype::column_alignment);
+                columns.push_back({ component_id<T>(), static_cast<uint32_t>(sizeof(T)) });
+            }
+        };
+        (add_column(static_cast<Ts*>(nullptr)), ...);
+        const auto index = static_cast<uint32_t>(archetypes_.size());
+        archetypes_.push_back(std::make_unique<archetype>(mask, std::move(columns), chunk_pool_));
+        archetype_lookup_.emplace(mask, index);
+        return index;
+    }
+
+    entity_handle allocate_handle();
+
+    // Declared first so it outlives the archetypes returning their chunks to it.
+    archetype_chunk_pool chunk_pool_{ "entity chunks" };
+    std::vector<std::unique_ptr<archetype>> archetypes_;
+    std::unordered_map<component_mask, uint32_t> archetype_lookup_;
+    std::vector<slot> slots_;
+    std::vector<uint32_t> free_slots_;
+    size_t alive_ = 0;
+};
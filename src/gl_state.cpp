@@ -0,0 +1,133 @@
+#include "gl_state.h"
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+void gl_state::use_program(GLuint program)
+{
+    if (program_ == program)
+    {
+        stats_.skipped++;
+        return;
+    }
+    glUseProgram(program);
+    program_ = program;
+    stats_.program_binds++;
+}
+
+void gl_state::bind_vertex_array(GLuint vao)
+{
+    if (vao_ == vao)
+    {
+        stats_.skipped++;
+        return;
+    }
+    glBindVertexArray(vao);
+    vao_ = vao;
+    stats_.vertex_array_binds++;
+}
+
+void gl_state::bind_texture(GLuint unit, GLuint texture)
+{
+    if (unit < texture_units && textures_[unit] == texture)
+    {
+        stats_.skipped++;
+        return;
+    }
+    glBindTextureUnit(unit, texture);
+    if (unit < texture_units)
+    {
+        textures_[unit] = texture;
+    }
+    stats_.texture_binds++;
+}
+
+void gl_state::bind_draw_indirect_buffer(GLuint buffer)
+{
+    if (indirect_buffer_ == buffer)
+    {
+        stats_.skipped++;
+        return;
+    }
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, buffer);
+    indirect_buffer_ = buffer;
+    stats_.buffer_binds++;
+}
+
+void gl_state::bind_storage_buffer(GLuint index, GLuint buffer)
+{
+    if (index < storage_bindings && storage_buffers_[index] == buffer)
+    {
+        stats_.skipped++;
+        return;
+    }
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, index, buffer);
+    if (index < storage_bindings)
+    {
+        storage_buffers_[index] = buffer;
+    }
+    stats_.buffer_binds++;
+}
+
+void gl_state::set_uniform(GLuint program, GLint location, float value)
+{
+    if (update_uniform(program, location, &value, 1))
+    {
+        glProgramUniform1f(program, location, value);
+    }
+}
+
+void gl_state::set_uniform(GLuint program, GLint location, const glm::mat4& value)
+{
+    if (update_uniform(program, location, glm::value_ptr(value), 16))
+    {
+        glProgramUniformMatrix4fv(program, location, 1, GL_FALSE, glm::value_ptr(value));
+    }
+}
+
+bool gl_state::update_uniform(GLuint program, GLint location, const float* value, uint32_t size)
+{
+    if (location < 0)
+    {
+        return false;
+    }
+    const size_t bytes = sizeof(float) * size;
+    for (uniform_value& cached : uniforms_)
+    {
+        if (cached.program == program && cached.location == location)
+        {
+            if (cached.size == size && std::memcmp(cached.value, value, bytes) == 0)
+            {
+                stats_.skipped++;
+                return false;
+            }
+            cached.size = size;
+            std::memcpy(cached.value, value, bytes);
+            stats_.uniform_uploads++;
+            return true;
+        }
+    }
+    uniform_value& cached = uniforms_.emplace_back();
+    cached.program = program;
+    cached.location = location;
+    cached.size = size;
+    std::memcpy(cached.value, value, bytes);
+    stats_.uniform_uploads++;
+    return true;
+}
+
+void gl_state::invalidate_bindings()
+{
+    program_ = unknown;
+    vao_ = unknown;
+    std::fill(std::begin(textures_), std::end(textures_), unknown);
+    indirect_buffer_ = unknown;
+    std::fill(std::begin(storage_buffers_), std::end(storage_buffers_), unknown);
+}
+
+void gl_state::invalidate()
+{
+    invalidate_bindings();
+    uniforms_.clear();
+}
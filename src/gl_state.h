@@ -0,0 +1,69 @@
+#pragma once
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+// GL calls made and skipped by a gl_state since the last reset_stats().
+struct gl_state_stats
+{
+    uint32_t program_binds;
+    uint32_t vertex_array_binds;
+    uint32_t texture_binds;
+    uint32_t buffer_binds;
+    uint32_t uniform_uploads;
+    uint32_t skipped; // calls that would not have changed anything
+};
+
+// Remembers what is bound and which uniform values were uploaded, and only calls GL when something
+// actually changes. Everything the renderer binds goes through here; code that binds behind its
+// back (ImGui, a shader reload) must be followed by one of the invalidate calls.
+class gl_state
+{
+public:
+    static constexpr GLuint texture_units = 16;
+    static constexpr GLuint storage_bindings = 8;
+
+    void use_program(GLuint program);
+    void bind_vertex_array(GLuint vao);
+    void bind_texture(GLuint unit, GLuint texture);
+    void bind_draw_indirect_buffer(GLuint buffer);
+    void bind_storage_buffer(GLuint index, GLuint buffer);
+
+    // Uploaded with glProgramUniform*, so the program doesn't need to be bound.
+    void set_uniform(GLuint program, GLint location, float value);
+    void set_uniform(GLuint program, GLint location, const glm::mat4& value);
+
+    // Forgets every binding; the next bind of anything always reaches GL.
+    void invalidate_bindings();
+    // Also forgets uploaded uniform values. Needed after programs are relinked or deleted, because
+    // a new program can reuse an old name.
+    void invalidate();
+
+    const gl_state_stats& stats() const { return stats_; }
+    void reset_stats() { stats_ = {}; }
+
+private:
+    // Never a name GL hands out, so it compares unequal to anything that gets bound.
+    static constexpr GLuint unknown = ~GLuint{ 0 };
+
+    struct uniform_value
+    {
+        GLuint program;
+        GLint location;
+        uint32_t size; // floats used in `value`
+        float value[16];
+    };
+
+    // True when the value changed and must be uploaded.
+    bool update_uniform(GLuint program, GLint location, const float* value, uint32_t size);
+
+    GLuint program_ = unknown;
+    GLuint vao_ = unknown;
+    GLuint textures_[texture_units] = { unknown, unknown, unknown, unknown, unknown, unknown, unknown, unknown,
+        unknown, unknown, unknown, unknown, unknown, unknown, unknown, unknown };
+    GLuint indirect_buffer_ = unknown;
+    GLuint storage_buffers_[storage_bindings] = { unknown, unknown, unknown, unknown, unknown, unknown, unknown, unknown };
+    std::vector<uniform_value> uniforms_; // a handful per program, so a linear search is fastest
+    gl_state_stats stats_ = {};
+};
@@ -0,0 +1,53 @@
+#include "gpu_timers.h"
+
+#if GAME_PERF_OVERLAY
+
+#include <tracy/Tracy.hpp>
+
+gpu_timers::gpu_timers()
+{
+    glCreateQueries(GL_TIME_ELAPSED, frames_in_flight * pass_count, &queries_[0][0]);
+}
+
+gpu_timers::~gpu_timers()
+{
+    glDeleteQueries(frames_in_flight * pass_count, &queries_[0][0]);
+}
+
+void gpu_timers::begin(gpu_pass pass)
+{
+    glBeginQuery(GL_TIME_ELAPSED, queries_[frame_][static_cast<uint32_t>(pass)]);
+}
+
+void gpu_timers::end(gpu_pass pass)
+{
+    glEndQuery(GL_TIME_ELAPSED);
+    issued_[frame_][static_cast<uint32_t>(pass)] = true;
+}
+
+void gpu_timers::collect()
+{
+    // The next frame reuses the oldest set of queries, so this is the last chance to read them.
+    frame_ = (frame_ + 1) % frames_in_flight;
+    for (uint32_t pass = 0; pass < pass_count; pass++)
+    {
+        if (!issued_[frame_][pass])
+        {
+            continue;
+        }
+        issued_[frame_][pass] = false;
+        GLint available = GL_FALSE;
+        glGetQueryObjectiv(queries_[frame_][pass], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+        {
+            continue;
+        }
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(queries_[frame_][pass], GL_QUERY_RESULT, &nanoseconds);
+        milliseconds_[pass] = static_cast<double>(nanoseconds) / 1e6;
+    }
+    TracyPlot("gpu scene ms", milliseconds(gpu_pass::scene));
+    TracyPlot("gpu ui ms", milliseconds(gpu_pass::ui));
+}
+
+#endif
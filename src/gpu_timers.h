@@ -0,0 +1,72 @@
+#pragma once
+#include <glad/gl.h>
+#include <cstdint>
+
+// Render passes timed on the GPU.
+enum class gpu_pass : uint32_t
+{
+    scene,
+    ui,
+    count
+};
+
+#if GAME_PERF_OVERLAY
+
+// GL_TIME_ELAPSED queries around each render pass, double-buffered: collect() reads back the
+// previous frame's queries, one frame of latency, and only if the GPU has already finished them, so
+// collecting never stalls. A result that isn't ready in time is dropped and the previous value is kept.
+class gpu_timers
+{
+public:
+    static constexpr uint32_t frames_in_flight = 2;
+
+    gpu_timers();
+    ~gpu_timers();
+
+    gpu_timers(const gpu_timers&) = delete;
+    gpu_timers& operator=(const gpu_timers&) = delete;
+
+    // Passes can't nest: GL allows only one GL_TIME_ELAPSED query at a time.
+    void begin(gpu_pass pass);
+    void end(gpu_pass pass);
+    // Call once per frame after the last pass.
+    void collect();
+
+    double milliseconds(gpu_pass pass) const { return milliseconds_[static_cast<uint32_t>(pass)]; }
+
+private:
+    static constexpr uint32_t pass_count = static_cast<uint32_t>(gpu_pass::count);
+
+    GLuint queries_[frames_in_flight][pass_count] = {};
+    bool issued_[frames_in_flight][pass_count] = {};
+    uint32_t frame_ = 0;
+    double milliseconds_[pass_count] = {};
+};
+
+#else
+
+class gpu_timers
+{
+public:
+    void begin(gpu_pass) {}
+    void end(gpu_pass) {}
+    void collect() {}
+    double milliseconds(gpu_pass) const { return 0.0; }
+};
+
+#endif
+
+// Times a pass for as long as it is in scope.
+class gpu_pass_scope
+{
+public:
+    gpu_pass_scope(gpu_timers& timers, gpu_pass pass) : timers_(timers), pass_(pass) { timers_.begin(pass_); }
+    ~gpu_pass_scope() { timers_.end(pass_); }
+
+    gpu_pass_scope(const gpu_pass_scope&) = delete;
+    gpu_pass_scope& operator=(const gpu_pass_scope&) = delete;
+
+private:
+    gpu_timers& timers_;
+    gpu_pass pass_;
+};
@@ -0,0 +1,23 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// 64-bit FNV-1a. Used for cache keys and file fingerprints, not for anything security related.
+constexpr uint64_t fnv1a_seed = 14695981039346656037ull;
+
+inline uint64_t fnv1a64(const void* data, size_t size, uint64_t hash = fnv1a_seed)
+{
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+inline uint64_t fnv1a64(std::string_view text, uint64_t hash = fnv1a_seed)
+{
+    return fnv1a64(text.data(), text.size(), hash);
+}
@@ -0,0 +1,217 @@
+#include "job_system.h"
+#include <tracy/Tracy.hpp>
+#include <string>
+
+namespace
+{
+    // Index of the worker running on this thread. Threads outside the job system use queue 0.
+    thread_local int current_worker = -1;
+}
+
+job_system::job_system(unsigned worker_count)
+{
+    worker_count = std::max(worker_count, 1u);
+    for (unsigned i = 0; i < worker_count; i++)
+    {
+        queues_.push_back(std::make_unique<worker_queue>());
+    }
+    current_worker = 0;
+    for (unsigned i = 1; i < worker_count; i++)
+    {
+        threads_.emplace_back([this, i] { worker_loop(i); });
+    }
+}
+
+job_system::~job_system()
+{
+    {
+        std::lock_guard lock(sleep_mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread& thread : threads_)
+    {
+        thread.join();
+    }
+}
+
+void job_system::worker_queue::push_back(const queued_job& j)
+{
+    if (count == ring.size())
+    {
+        std::vector<queued_job> grown(ring.size() * 2);
+        for (size_t i = 0; i < count; i++)
+        {
+            grown[i] = ring[(head + i) & (ring.size() - 1)];
+        }
+        ring.swap(grown);
+        head = 0;
+    }
+    ring[(head + count) & (ring.size() - 1)] = j;
+    count++;
+}
+
+bool job_system::worker_queue::pop_back(queued_job& out)
+{
+    if (count == 0)
+    {
+        return false;
+    }
+    count--;
+    out = ring[(head + count) & (ring.size() - 1)];
+    return true;
+}
+
+bool job_system::worker_queue::pop_front(queued_job& out)
+{
+    if (count == 0)
+    {
+        return false;
+    }
+    out = ring[head];
+    head = (head + 1) & (ring.size() - 1);
+    count--;
+    return true;
+}
+
+void job_system::submit(const job& j, job_counter& counter, const job_counter* dependency)
+{
+    counter.pending.fetch_add(1, std::memory_order_relaxed);
+    const queued_job queued = { j, &counter };
+    if (!dependency || dependency->pending.load(std::memory_order_acquire) == 0)
+    {
+        push(queued);
+        return;
+    }
+    {
+        std::lock_guard lock(deferred_mutex_);
+        deferred_.push_back({ queued, dependency });
+        deferred_count_.fetch_add(1, std::memory_order_seq_cst);
+    }
+    // The dependency may have finished before the job was parked, without seeing it; release it here
+    // then. The caller keeps the dependency alive, so reading it is safe.
+    if (dependency->pending.load(std::memory_order_seq_cst) == 0)
+    {
+        release_deferred(dependency);
+    }
+}
+
+void job_system::wait(const job_counter& counter)
+{
+    ZoneScopedN("job wait");
+    const unsigned self = current_worker < 0 ? 0 : static_cast<unsigned>(current_worker);
+    queued_job j;
+    while (!counter.done())
+    {
+        if (pop_or_steal(self, j))
+        {
+            execute(j);
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void job_system::push(const queued_job& j)
+{
+    const unsigned self = current_worker < 0 ? 0 : static_cast<unsigned>(current_worker);
+    {
+        std::lock_guard lock(queues_[self]->mutex);
+        queues_[self]->push_back(j);
+    }
+    queued_.fetch_add(1, std::memory_order_release);
+    {
+        // Taking the lock orders this with a worker that is about to sleep, so the wakeup isn't lost.
+        std::lock_guard lock(sleep_mutex_);
+    }
+    wake_.notify_one();
+}
+
+bool job_system::pop_or_steal(unsigned self, queued_job& out)
+{
+    {
+        worker_queue& own = *queues_[self];
+        std::lock_guard lock(own.mutex);
+        if (own.pop_back(out))
+        {
+            queued_.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    const auto count = static_cast<unsigned>(queues_.size());
+    for (unsigned offset = 1; offset < count; offset++)
+    {
+        worker_queue& victim = *queues_[(self + offset) % count];
+        std::lock_guard lock(victim.mutex);
+        if (victim.pop_front(out))
+        {
+            queued_.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void job_system::execute(const queued_job& j)
+{
+    {
+        ZoneScopedN("job");
+        j.work.function(j.work.context, j.work.begin, j.work.end);
+    }
+    // The counter may be destroyed by its waiter as soon as it is done, so it is pinned until its
+    // dependents have been released. A job parked after the check below sees the counter at zero
+    // and releases itself in submit().
+    job_counter& counter = *j.counter;
+    counter.releasing.fetch_add(1, std::memory_order_relaxed);
+    if (counter.pending.fetch_sub(1, std::memory_order_seq_cst) == 1 && deferred_count_.load(std::memory_order_seq_cst) > 0)
+    {
+        release_deferred(&counter);
+    }
+    counter.releasing.fetch_sub(1, std::memory_order_release);
+}
+
+void job_system::release_deferred(const job_counter* dependency)
+{
+    std::lock_guard lock(deferred_mutex_);
+    // Checked under the lock: the counter may have been reused for a new batch of jobs meanwhile.
+    if (dependency->pending.load(std::memory_order_acquire) != 0)
+    {
+        return;
+    }
+    for (size_t i = 0; i < deferred_.size();)
+    {
+        if (deferred_[i].dependency == dependency)
+        {
+            push(deferred_[i].job);
+            deferred_[i] = deferred_.back();
+            deferred_.pop_back();
+            deferred_count_.fetch_sub(1, std::memory_order_relaxed);
+            continue;
+        }
+        i++;
+    }
+}
+
+void job_system::worker_loop(unsigned index)
+{
+    current_worker = static_cast<int>(index);
+    const std::string name = "job worker " + std::to_string(index);
+    tracy::SetThreadName(name.c_str());
+    queued_job j;
+    for (;;)
+    {
+        if (pop_or_steal(index, j))
+        {
+            execute(j);
+            continue;
+        }
+        std::unique_lock lock(sleep_mutex_);
+        wake_.wait(lock, [this] { return stopping_.load() || queued_.load(std::memory_order_acquire) > 0; });
+        if (stopping_)
+        {
+            return;
+        }
+    }
+}
@@ -0,0 +1,131 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Counts outstanding jobs. A job signals its counter when it finishes; jobs submitted with a
+// dependency only start once that counter has dropped to zero. Wait on a counter before destroying
+// it, even when a later counter depending on it is already done.
+struct job_counter
+{
+    std::atomic<uint32_t> pending{ 0 };
+    // Workers still touching the counter after their job finished (to release its dependents).
+    std::atomic<uint32_t> releasing{ 0 };
+
+    bool done() const { return pending.load(std::memory_order_acquire) == 0 && releasing.load(std::memory_order_acquire) == 0; }
+};
+
+// A range of work. Plain function pointer + context so submitting a job never allocates.
+struct job
+{
+    void (*function)(void* context, size_t begin, size_t end);
+    void* context;
+    size_t begin;
+    size_t end;
+};
+
+// Work-stealing scheduler for short CPU-bound jobs (simulation, culling, ...). Every worker owns a
+// deque: it pushes and pops at the back, idle workers steal from the front of others. The thread
+// that created the job_system is worker 0 and runs jobs while it waits on a counter.
+class job_system
+{
+public:
+    explicit job_system(unsigned worker_count);
+    ~job_system();
+
+    job_system(const job_system&) = delete;
+    job_system& operator=(const job_system&) = delete;
+
+    unsigned worker_count() const { return static_cast<unsigned>(queues_.size()); }
+
+    void submit(const job& j, job_counter& counter, const job_counter* dependency = nullptr);
+    // Runs jobs on the calling thread until the counter reaches zero.
+    void wait(const job_counter& counter);
+
+    // Splits [0, count) into ranges of at most `grain` items and calls f(begin, end) for each range
+    // across all workers. Returns once every range has run.
+    template<typename F>
+    void parallel_for(size_t count, size_t grain, F&& f)
+    {
+        job_counter counter;
+        run_parallel_for(count, grain, f, counter, nullptr);
+        wait(counter);
+    }
+
+    // Like parallel_for but returns immediately; `counter` drops to zero once all ranges ran.
+    // `f` must stay alive until then.
+    template<typename F>
+    void parallel_for_async(size_t count, size_t grain, F& f, job_counter& counter, const job_counter* dependency = nullptr)
+    {
+        run_parallel_for(count, grain, f, counter, dependency);
+    }
+
+private:
+    struct queued_job
+    {
+        job work;
+        job_counter* counter;
+    };
+
+    // Ring buffer that grows by doubling and never shrinks, so submitting jobs doesn't allocate once
+    // the queues have seen a frame's worth of work. (std::deque frees and reallocates its blocks as
+    // the queue drains and refills.)
+    struct worker_queue
+    {
+        static constexpr size_t initial_capacity = 256;
+
+        std::mutex mutex;
+        std::vector<queued_job> ring = std::vector<queued_job>(initial_capacity); // size is a power of two
+        size_t head = 0; // index of the oldest job
+        size_t count = 0;
+
+        void push_back(const queued_job& j);
+        bool pop_back(queued_job& out);
+        bool pop_front(queued_job& out);
+    };
+
+    struct deferred_job
+    {
+        queued_job job;
+        const job_counter* dependency;
+    };
+
+    template<typename F>
+    void run_parallel_for(size_t count, size_t grain, F& f, job_counter& counter, const job_counter* dependency)
+    {
+        using function = std::remove_reference_t<F>;
+        grain = std::max<size_t>(grain, 1);
+        auto invoke = [](void* context, size_t begin, size_t end) { (*static_cast<function*>(context))(begin, end); };
+        for (size_t begin = 0; begin < count; begin += grain)
+        {
+            submit({ invoke, const_cast<void*>(static_cast<const void*>(&f)), begin, std::min(begin + grain, count) }, counter, dependency);
+        }
+    }
+
+    void push(const queued_job& j);
+    bool pop_or_steal(unsigned self, queued_job& out);
+    void execute(const queued_job& j);
+    // Queues the parked jobs waiting on `dependency` if it has reached zero. Jobs parked on other
+    // counters are only compared by address, since their counters may already be gone.
+    void release_deferred(const job_counter* dependency);
+    void worker_loop(unsigned index);
+
+    std::vector<std::unique_ptr<worker_queue>> queues_;
+    std::vector<std::thread> threads_;
+
+    std::mutex deferred_mutex_;
+    std::vector<deferred_job> deferred_;
+    std::atomic<uint32_t> deferred_count_{ 0 };
+
+    std::mutex sleep_mutex_;
+    std::condition_variable wake_;
+    std::atomic<uint32_t> queued_{ 0 };
+    std::atomic<bool> stopping_{ false };
+};
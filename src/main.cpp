@@ -1,49 +1,44 @@
 #include <tracy/Tracy.hpp>
 #include <glad/gl.h>
+#include <tracy/TracyOpenGL.hpp>
 #include <GLFW/glfw3.h>
 #include <imgui.h>
 #include <imgui_impl_glfw.h>
 #include <glm/glm.hpp>
 #include<glm/gtc/matrix_transform.hpp>
 #include<glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <cmath>
 #include <cstdio>
 #include <exception>
+#include <fstream>
 #include <iostream>
-#include <sstream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <thread>
 #include <vector>
 #include "imgui_impl_opengl3.h"
+#include "asset_loader.h"
+#include "benchmark.h"
+#include "camera.h"
+#include "entity.h"
+#include "gl_state.h"
+#include "gpu_timers.h"
+#include "job_system.h"
+#include "memory.h"
+#include "perf_overlay.h"
+#include "render_queue.h"
+#include "scene.h"
+#include "scene_file.h"
+#include "shader_manager.h"
+#include "simulation.h"
+#include "sprite_batch.h"
+#include "sprite_pipeline.h"
+#include "texture_atlas.h"
+#include "tilemap.h"
 
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
-
-
-enum class game_object
-{
-    PLAYER,
-    TERRAIN,
-    SLIME
-};
-
-struct entity
-{
-    game_object type;
-    glm::vec2 scale;
-    glm::vec2 position;
-};
-
-entity create_player_entity(float x, float y)
-{
-    entity PLAYER;
-    PLAYER.type = game_object::PLAYER;
-    PLAYER.scale = { 128, 128 };
-    PLAYER.position = { x, y };
-    return PLAYER;
-}
-
-entity create_slime_entity(float x, float y)
-{
-    return{ game_object::SLIME, {64, 64}, {x , y} };
-}
 
 namespace
 {
@@ -68,126 +63,182 @@ namespace
       )
       return;
 
-    std::stringstream errStream;
-    errStream << "OpenGL Debug message (" << id << "): " << message << '\n';
-
+    // Written straight to std::cout so reporting a message never allocates.
+    const char* sourceName = "";
     switch (source)
     {
-    case GL_DEBUG_SOURCE_API: errStream << "Source: API"; break;
-    case GL_DEBUG_SOURCE_WINDOW_SYSTEM: errStream << "Source: Window Manager"; break;
-    case GL_DEBUG_SOURCE_SHADER_COMPILER: errStream << "Source: Shader Compiler"; break;
-    case GL_DEBUG_SOURCE_THIRD_PARTY: errStream << "Source: Third Party"; break;
-    case GL_DEBUG_SOURCE_APPLICATION: errStream << "Source: Application"; break;
-    case GL_DEBUG_SOURCE_OTHER: errStream << "Source: Other"; break;
+    case GL_DEBUG_SOURCE_API: sourceName = "API"; break;
+    case GL_DEBUG_SOURCE_WINDOW_SYSTEM: sourceName = "Window Manager"; break;
+    case GL_DEBUG_SOURCE_SHADER_COMPILER: sourceName = "Shader Compiler"; break;
+    case GL_DEBUG_SOURCE_THIRD_PARTY: sourceName = "Third Party"; break;
+    case GL_DEBUG_SOURCE_APPLICATION: sourceName = "Application"; break;
+    case GL_DEBUG_SOURCE_OTHER: sourceName = "Other"; break;
     }
 
-    errStream << '\n';
-
+    const char* typeName = "";
     switch (type)
     {
-    case GL_DEBUG_TYPE_ERROR: errStream << "Type: Error"; break;
-    case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: errStream << "Type: Deprecated Behaviour"; break;
-    case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR: errStream << "Type: Undefined Behaviour"; break;
-    case GL_DEBUG_TYPE_PORTABILITY: errStream << "Type: Portability"; break;
-    case GL_DEBUG_TYPE_PERFORMANCE: errStream << "Type: Performance"; break;
-    case GL_DEBUG_TYPE_MARKER: errStream << "Type: Marker"; break;
-    case GL_DEBUG_TYPE_PUSH_GROUP: errStream << "Type: Push Group"; break;
-    case GL_DEBUG_TYPE_POP_GROUP: errStream << "Type: Pop Group"; break;
-    case GL_DEBUG_TYPE_OTHER: errStream << "Type: Other"; break;
+    case GL_DEBUG_TYPE_ERROR: typeName = "Error"; break;
+    case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: typeName = "Deprecated Behaviour"; break;
+    case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR: typeName = "Undefined Behaviour"; break;
+    case GL_DEBUG_TYPE_PORTABILITY: typeName = "Portability"; break;
+    case GL_DEBUG_TYPE_PERFORMANCE: typeName = "Performance"; break;
+    case GL_DEBUG_TYPE_MARKER: typeName = "Marker"; break;
+    case GL_DEBUG_TYPE_PUSH_GROUP: typeName = "Push Group"; break;
+    case GL_DEBUG_TYPE_POP_GROUP: typeName = "Pop Group"; break;
+    case GL_DEBUG_TYPE_OTHER: typeName = "Other"; break;
     }
 
-    errStream << '\n';
-
+    const char* severityName = "";
     switch (severity)
     {
-    case GL_DEBUG_SEVERITY_HIGH: errStream << "Severity: high"; break;
-    case GL_DEBUG_SEVERITY_MEDIUM: errStream << "Severity: medium"; break;
-    case GL_DEBUG_SEVERITY_LOW: errStream << "Severity: low"; break;
-    case GL_DEBUG_SEVERITY_NOTIFICATION: errStream << "Severity: notification"; break;
+    case GL_DEBUG_SEVERITY_HIGH: severityName = "high"; break;
+    case GL_DEBUG_SEVERITY_MEDIUM: severityName = "medium"; break;
+    case GL_DEBUG_SEVERITY_LOW: severityName = "low"; break;
+    case GL_DEBUG_SEVERITY_NOTIFICATION: severityName = "notification"; break;
     }
 
-    std::cout << errStream.str() << '\n';
+    std::cout << "OpenGL Debug message (" << id << "): " << message << '\n'
+      << "Source: " << sourceName << '\n'
+      << "Type: " << typeName << '\n'
+      << "Severity: " << severityName << "\n\n";
   }
-} // namespace
 
-// Square corrdinates
-float vertices[] = {
-    // positions          // colors           // texture coords
-     0.5f,  0.5f, 0.0f,   1.0f, 0.0f, 0.0f,   1.0f, 1.0f,   // top right
-     0.5f, -0.5f, 0.0f,   0.0f, 1.0f, 0.0f,   1.0f, 0.0f,   // bottom right
-    -0.5f, -0.5f, 0.0f,   0.0f, 0.0f, 1.0f,   0.0f, 0.0f,   // bottom left
-    -0.5f,  0.5f, 0.0f,   1.0f, 1.0f, 0.0f,   0.0f, 1.0f    // top left 
-};
-unsigned int indices[] = {  // note that we start from 0!
-    0, 1, 3,   // first triangle
-    1, 2, 3,    // second triangle
-};
-
-const char* vertexShaderSource = R"(#version 330 core
-layout (location = 0) in vec2 aPos;
-layout (location = 1) in vec3 aColor;
-layout (location = 2) in vec2 aTexCoord;
-
-out vec3 ourColor;
-out vec2 TexCoord;
-uniform mat4 projection;
-uniform vec2 scale;
-uniform vec2 position;
-
-void main()
-{
-   gl_Position = projection * vec4(aPos * scale + position, 0.0, 1.0);
-   ourColor = aColor;
-   TexCoord = aTexCoord;
-}
-)";
+  // Parses a whole numeric argument in [0, max]. Prints what was wrong and returns false otherwise.
+  template<typename T>
+  bool parse_argument(const std::string& flag, const char* text, T max, T& out)
+  {
+    try
+    {
+      size_t used = 0;
+      T value;
+      if constexpr (std::is_floating_point_v<T>)
+      {
+        value = std::stod(text, &used);
+      }
+      else
+      {
+        value = std::stoi(text, &used);
+      }
+      // std::stod also accepts "inf" and "nan".
+      if (text[used] == '\0' && std::isfinite(static_cast<double>(value)) && value >= 0 && value <= max)
+      {
+        out = value;
+        return true;
+      }
+    }
+    catch (const std::logic_error&) // std::invalid_argument or std::out_of_range
+    {
+    }
+    std::cout << "Invalid value for " << flag << ": \"" << text << "\" (expected a number from 0 to " << max << ")\n";
+    return false;
+  }
+} // namespace
 
-const char* fragmentShaderSource = R"(#version 330 core
-out vec4 FragColor;
+// Stress scene: fills the world with slimes so the sprite batcher can be profiled at scale.
+const int stress_counts[] = { 0, 1'000, 10'000, 100'000 };
 
-in vec3 ourColor;
-in vec2 TexCoord;
+// Upper bounds for command line values, far above anything useful but small enough that the
+// entities, tiles and per-frame timing buffers they size always fit in memory.
+constexpr int max_stress_count = 10'000'000;
+constexpr int max_terrain_tiles = 16'000'000;
+constexpr double max_headless_seconds = 3600.0;
 
-uniform sampler2D ourTexture;
 
-void main()
+int main(int argc, const char* const* argv)
 {
-   FragColor = texture(ourTexture, TexCoord);
-}
-)";
-
-GLuint load_texture(const char* path) {
-    // Load Texture
-    unsigned int texture;
-    glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_2D, texture);
-    // set the texture wrapping/filtering options (on the currently bound texture object)
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    // load and generate the texture
-    int width, height, nrChannels;
-    //stbi_set_flip_vertically_on_load(true);
-    unsigned char* data = stbi_load(path, &width, &height, &nrChannels, 4);
-    if (data)
+  ZoneScoped; // Tells Tracy to profile this scope
+
+  // --stress <count> starts with the stress scene already populated.
+  // --headless runs the scene without a window and prints a JSON frame-time report instead; see benchmark.h.
+  //   --terrain <count>, --seconds <simulated seconds>, --render (draw offscreen), --report <file>
+  // --shader-dir <dir> loads shaders from another directory, e.g. data/shaders, and hot-reloads edits to them.
+  //   Debug builds always hot-reload; release builds otherwise never watch the shader sources.
+  // --scene <file> loads the level (entities and terrain) from a binary scene file; see scene_file.h. Its slimes
+  //   are the stress set, so --stress or the stress UI replaces them rather than adding more.
+  // --export-scene <file> writes the starting level to a binary scene file.
+  int stress_count = 0;
+  bool headless = false;
+  benchmark_scene headlessScene;
+  headlessScene.name = "headless";
+  std::string reportPath;
+  std::string shaderDir = "shaders";
+#ifdef NDEBUG
+  bool hotReload = false;
+#else
+  bool hotReload = true;
+#endif
+  std::string scenePath;
+  std::string exportScenePath;
+  for (int i = 1; i < argc; i++)
+  {
+    const std::string arg = argv[i];
+    const bool hasValue = i + 1 < argc;
+    if (arg == "--stress" && hasValue)
     {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
+      if (!parse_argument(arg, argv[++i], max_stress_count, stress_count))
+      {
+        return 1;
+      }
     }
-    else
+    else if (arg == "--terrain" && hasValue)
     {
-        std::cout << "Failed to load texture" << std::endl;
+      if (!parse_argument(arg, argv[++i], max_terrain_tiles, headlessScene.terrain))
+      {
+        return 1;
+      }
     }
-    stbi_image_free(data);
-    return(texture);
-}
-
-
+    else if (arg == "--seconds" && hasValue)
+    {
+      if (!parse_argument(arg, argv[++i], max_headless_seconds, headlessScene.seconds))
+      {
+        return 1;
+      }
+    }
+    else if (arg == "--report" && hasValue)
+    {
+      reportPath = argv[++i];
+    }
+    else if (arg == "--shader-dir" && hasValue)
+    {
+      shaderDir = argv[++i];
+      hotReload = true;
+    }
+    else if (arg == "--scene" && hasValue)
+    {
+      scenePath = argv[++i];
+    }
+    else if (arg == "--export-scene" && hasValue)
+    {
+      exportScenePath = argv[++i];
+    }
+    else if (arg == "--headless")
+    {
+      headless = true;
+    }
+    else if (arg == "--render")
+    {
+      headlessScene.render = true;
+    }
+  }
 
-int main([[maybe_unused]] int argc, [[maybe_unused]] const char* const* argv)
-{
-  ZoneScoped; // Tells Tracy to profile this scope
+  if (headless)
+  {
+    headlessScene.slimes = stress_count;
+    const benchmark_result result = run_benchmark(headlessScene);
+    if (reportPath.empty())
+    {
+      write_benchmark_json(std::cout, { &result, 1 });
+      return 0;
+    }
+    std::ofstream report(reportPath);
+    if (!report)
+    {
+      throw std::runtime_error("Failed to open " + reportPath);
+    }
+    write_benchmark_json(report, { &result, 1 });
+    return 0;
+  }
 
   // Initialiize GLFW
   if (!glfwInit())
@@ -232,7 +283,8 @@ int main([[maybe_unused]] int argc, [[maybe_unused]] const char* const* argv)
   glfwMakeContextCurrent(window);
   glfwSwapInterval(1); // 1 = vsync, 0 = no vsync
 
-  glm::mat4 projection = glm::ortho(0.0f, static_cast<float>(windowWidth), static_cast<float>(windowHeight), 0.0f, -1.0f, 1.0f);
+  // Starts out showing the same area the old fixed projection did; arrow keys pan, +/- zoom
+  camera cam = { { static_cast<float>(windowWidth) / 2, static_cast<float>(windowHeight) / 2 }, { static_cast<float>(windowWidth), static_cast<float>(windowHeight) } };
 
   // Load OpenGL function pointers
   int version = gladLoadGL(glfwGetProcAddress);
@@ -241,6 +293,7 @@ int main([[maybe_unused]] int argc, [[maybe_unused]] const char* const* argv)
     glfwTerminate();
     throw std::runtime_error("Failed to initialize OpenGL");
   }
+  TracyGpuContext;
 
   // Set up the GL debug message callback. OpenglErrorCallback gets invoked whenever you make a goof with the API.
   glEnable(GL_DEBUG_OUTPUT);
@@ -256,81 +309,110 @@ int main([[maybe_unused]] int argc, [[maybe_unused]] const char* const* argv)
   ImGui::StyleColorsDark();
   ImGui::GetIO().ConfigFlags |= ImGuiConfigFlags_DockingEnable;
 
-  // Vertex buffer object
-  unsigned int VBO;
-  glGenBuffers(1, &VBO);
-
-  // Vertex shader
-  unsigned int vertexShader;
-  vertexShader = glCreateShader(GL_VERTEX_SHADER);
-  glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-  glCompileShader(vertexShader);
+  // Shaders load from shaders/ (or --shader-dir, e.g. data/shaders for live editing); with hot reload
+  // they are rebuilt whenever a source changes. Linked programs are cached in shader_cache/
+  std::optional<shader_manager> shaders;
+  shaders.emplace(shaderDir, "shader_cache", hotReload);
 
-  // Error checking
-  int  success;
-  char infoLog[512];
-  glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
+  // Unit quad and sprite shader
+  sprite_pipeline pipeline = create_sprite_pipeline(*shaders);
 
-  if (!success)
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  // Textures are decoded on worker threads and streamed in at most 4 MiB per frame
+  std::optional<asset_loader> assets;
+  assets.emplace(std::max(std::thread::hardware_concurrency(), 2u) - 1, 4 << 20);
+
+  // Everything under models/ is packed into one array texture; atlas.cache skips decoding on later runs
+  std::optional<texture_atlas> atlas;
+  atlas.emplace(*assets, "models", "atlas.cache");
+  const sprite_handle player_sprite = atlas->find("Sprite-0002");
+  const sprite_handle slime_sprite = atlas->find("red_wizard");
+
+  // Owns GL objects, so it is destroyed explicitly before the context goes away
+  std::optional<sprite_batch> sprites;
+  sprites.emplace(pipeline.vao, sprite_batch::default_capacity);
+
+  // A 16k x 16k pixel map unless the level says otherwise; only the chunks in view are drawn
+  std::optional<tilemap> terrain;
+  entity_registry registry;
+  entity_handle player = null_entity;
+  // The stress set: the level's slimes, if any, until the stress UI replaces them
+  std::vector<entity_handle> slimes;
+  if (scenePath.empty())
   {
-      glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-      std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
+    terrain.emplace(pipeline, 256, 256, 64.0f);
+    fill_terrain(*terrain, atlas->find("Sprite-0002"), terrain->width() * terrain->height() / 2);
   }
-
-  // Fragment shader
-  unsigned int fragmentShader;
-  fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-  glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-  glCompileShader(fragmentShader);
-
-  unsigned int shaderProgram;
-  shaderProgram = glCreateProgram();
-
-  glAttachShader(shaderProgram, vertexShader);
-  glAttachShader(shaderProgram, fragmentShader);
-  glLinkProgram(shaderProgram);
-
-  // Error checking
-  glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-  if (!success) {
-      glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
+  else
+  {
+    // The file is mapped and its entity columns are copied straight into the registry's chunks
+    const scene_file level(scenePath);
+    const std::vector<sprite_handle> levelAssets = level.resolve_assets(*atlas);
+    const scene_file_header& levelHeader = level.header();
+    if (levelHeader.map_width > 0 && levelHeader.map_height > 0)
+    {
+      terrain.emplace(pipeline, levelHeader.map_width, levelHeader.map_height, levelHeader.tile_size);
+      level.load_tiles(*terrain, levelAssets);
+    }
+    else
+    {
+      terrain.emplace(pipeline, 256, 256, 64.0f);
+    }
+    level.instantiate(registry, levelAssets);
+    registry.each_chunk<position>(with<player_tag>{}, [&player](uint32_t, const entity_handle* handles, position*) { player = handles[0]; });
+    registry.each_chunk<position>(with<slime_tag>{}, [&slimes](uint32_t count, const entity_handle* handles, position*) { slimes.insert(slimes.end(), handles, handles + count); });
+  }
+  if (player == null_entity)
+  {
+    player = create_player_entity(registry, player_sprite, static_cast<float>(windowWidth) / 2, static_cast<float>(windowHeight) / 2);
+  }
+  const aabb world = { { 0.0f, 0.0f }, { static_cast<float>(windowWidth), static_cast<float>(windowHeight) } };
+  // A level keeps its own slimes unless --stress asks for some instead
+  if (scenePath.empty() || stress_count > 0)
+  {
+    spawn_stress_slimes(registry, slimes, slime_sprite, stress_count, world);
+  }
+  if (!exportScenePath.empty())
+  {
+    export_scene(exportScenePath, registry, { terrain->width(), terrain->height(), terrain->tile_size(), terrain->tiles() }, atlas->names());
   }
 
-  glUseProgram(shaderProgram);
-  glDeleteShader(vertexShader);
-  glDeleteShader(fragmentShader);
-
-  unsigned int EBO;
-  glGenBuffers(1, &EBO);
-
-  unsigned int VAO;
-  glGenVertexArrays(1, &VAO);
-  // ..:: Initialization code (done once (unless your object frequently changes)) :: ..
-  // 1. bind Vertex Array Object
-  glBindVertexArray(VAO);
-  // 2. copy our vertices array in a buffer for OpenGL to use
-  glBindBuffer(GL_ARRAY_BUFFER, VBO);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-  // 3. copy our index array in a element buffer for OpenGL to use
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-  // 4. then set the vertex attributes pointers
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-  glEnableVertexAttribArray(0);
-  glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-  glEnableVertexAttribArray(2);
+  // The main thread is job worker 0 and helps out whenever it waits on jobs
+  job_system jobs(std::max(std::thread::hardware_concurrency(), 1u));
+  // Scratch memory for the current frame; reset at the top of every iteration of the game loop
+  frame_memory frameMemory;
+  simulation sim(jobs, frameMemory, world);
+  std::vector<uint32_t> touching;
+  double previousTime = glfwGetTime();
 
-  glEnable(GL_BLEND);
-  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-  GLuint player_texture = load_texture("models/Sprite-0002.png");
+  // GPU time per pass and per-frame counters, shown in the performance overlay
+  std::optional<gpu_timers> gpuTimers;
+  gpuTimers.emplace();
+  perf_overlay overlay;
+
+  // Every draw goes through the queue, sorted by layer and state, so the UI always ends up on top
+  std::optional<render_queue> queue;
+  queue.emplace();
+  gl_state glState;
 
-  std::vector<entity> entities;
-  entities.push_back(create_player_entity(static_cast<float>(windowWidth) / 2, static_cast<float>(windowHeight) / 2));
   //Game loop
   while(!glfwWindowShouldClose(window))
   {
     // Profile the main loop
     ZoneTransient(mainLoop, true);
+    frameMemory.begin_frame();
+    const uint64_t heapAllocationsBefore = heap_allocation_count();
+
+    const double currentTime = glfwGetTime();
+    const float frameSeconds = static_cast<float>(currentTime - previousTime);
+    // Slimes are drawn toward the player but never get faster than they started out
+    sim.set_steering(registry.get<position>(player)->value, 40.0f, 120.0f);
+    const float alpha = sim.advance(registry, currentTime - previousTime);
+    frame_timings timings = {};
+    timings.frame_ms = (currentTime - previousTime) * 1000.0;
+    timings.update_ms = (glfwGetTime() - currentTime) * 1000.0;
+    previousTime = currentTime;
 
     // Clear the window
     glClearColor(1.0f, 0.0f, 0.5f, 1.0f);
@@ -342,49 +424,144 @@ int main([[maybe_unused]] int argc, [[maybe_unused]] const char* const* argv)
     ImGui::NewFrame();
 
     glfwPollEvents();
+    assets->update();
+    atlas->update();
+    if (shaders->reload_changed())
+    {
+      // Reloaded programs can reuse old names, so cached uniform values mean nothing anymore
+      glState.invalidate();
+    }
     if (glfwGetKey(window, GLFW_KEY_ESCAPE))
     {
       glfwSetWindowShouldClose(window, true);
     }
+    const glm::vec2 pan = { static_cast<float>(glfwGetKey(window, GLFW_KEY_RIGHT) - glfwGetKey(window, GLFW_KEY_LEFT)),
+      static_cast<float>(glfwGetKey(window, GLFW_KEY_DOWN) - glfwGetKey(window, GLFW_KEY_UP)) };
+    cam.center += pan * (800.0f * frameSeconds / cam.zoom);
+    if (glfwGetKey(window, GLFW_KEY_EQUAL) || glfwGetKey(window, GLFW_KEY_KP_ADD))
+    {
+      cam.zoom = std::min(cam.zoom * (1.0f + frameSeconds), 4.0f);
+    }
+    if (glfwGetKey(window, GLFW_KEY_MINUS) || glfwGetKey(window, GLFW_KEY_KP_SUBTRACT))
+    {
+      cam.zoom = std::max(cam.zoom / (1.0f + frameSeconds), 0.125f);
+    }
 
 
 
     // Create a window with ImGui and put some text in it
     ImGui::Begin("Test window");
     ImGui::Text("bababooey");
-    ImGui::SliderFloat2("position", glm::value_ptr(entities[0].position), 0, static_cast<float>(windowWidth));
-    ImGui::SliderFloat2("scale", glm::value_ptr(entities[0].scale), 0, 1000);
+    ImGui::SliderFloat2("position", glm::value_ptr(registry.get<position>(player)->value), 0, static_cast<float>(windowWidth));
+    ImGui::SliderFloat2("scale", glm::value_ptr(registry.get<scale>(player)->value), 0, 1000);
+    ImGui::End();
+
+    ImGui::Begin("Stress");
+    for (int count : stress_counts)
+    {
+      if (ImGui::RadioButton(std::to_string(count).c_str(), stress_count == count))
+      {
+        stress_count = count;
+        spawn_stress_slimes(registry, slimes, slime_sprite, stress_count, world);
+      }
+      ImGui::SameLine();
+    }
+    ImGui::Text("slimes");
+    ImGui::Text("draw items: %u", sprites->stats().draw_items);
+    ImGui::Text("instances: %u", sprites->stats().instances);
+    ImGui::Text("submit: %.3f ms", sprites->stats().submit_ms);
+    ImGui::Text("movement kernel: %s", simd_level_name(sim.movement_simd()));
+    touching.clear();
+    const glm::vec2 playerHalf = registry.get<scale>(player)->value * 0.5f;
+    const glm::vec2 playerPos = registry.get<position>(player)->value;
+    sim.broadphase().query_rect({ playerPos - playerHalf, playerPos + playerHalf }, touching);
+    size_t touchingSlimes = 0;
+    for (uint32_t id : touching)
+    {
+      touchingSlimes += sim.broadphase_owner(id) != player;
+    }
+    ImGui::Text("slimes touching player: %zu", touchingSlimes);
     ImGui::End();
 
-    // Draw ImGui to the screen
+    ImGui::Begin("Camera");
+    ImGui::SliderFloat2("center", glm::value_ptr(cam.center), terrain->bounds().min.x, terrain->bounds().max.x);
+    ImGui::SliderFloat("zoom", &cam.zoom, 0.125f, 4.0f);
+    ImGui::Text("terrain chunks drawn: %u", terrain->stats().visible_chunks);
+    ImGui::Text("terrain chunks baked: %u", terrain->stats().baked_chunks);
+    ImGui::Text("terrain tiles drawn: %u", terrain->stats().tiles);
+    ImGui::End();
+
+    overlay.draw();
+
     ImGui::Render();
-    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
-  
+
     // ..:: Drawing code (in render loop) :: ..
-    // 4. draw the object
-    glUseProgram(shaderProgram);
-    int projectionLoc = glGetUniformLocation(shaderProgram, "projection");
-    glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, glm::value_ptr(projection));
-    glBindVertexArray(VAO);
-    for (const auto& entity : entities)
+    // 4. queue the scene, then draw it and the UI in layer order
+    glState.reset_stats();
+    queue->begin();
+    const GLuint spriteProgram = shaders->program(pipeline.program);
+    glState.set_uniform(spriteProgram, shaders->uniform(pipeline.program, "projection"), view_projection(cam));
+    // Animated sprites pick their frame from this on the GPU
+    glState.set_uniform(spriteProgram, shaders->uniform(pipeline.program, "time"), static_cast<float>(currentTime));
+    atlas->bind_clips(glState);
+    terrain->draw(*queue, spriteProgram, *atlas, view_rect(cam));
+    sprites->begin();
+    // Each chunk of entities is written straight into the mapped instance buffer
+    registry.each_chunk<position, previous_position, scale, sprite>([&](uint32_t count, const entity_handle*, position* p, previous_position* prev, scale* s, sprite* t)
+    {
+        const std::span<sprite_instance> instances = sprites->allocate(atlas->texture(), count);
+        write_sprite_instances(*atlas, alpha, static_cast<uint32_t>(instances.size()), p, prev, s, t, instances.data());
+    });
+    sprites->flush(*queue, spriteProgram);
+    queue->push(render_layer::ui, 0, [](void*) { ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData()); }, nullptr);
     {
-        if (entity.type == game_object::PLAYER)
-        {
-            glBindTexture(GL_TEXTURE_2D, player_texture);
-        }
-        int scaleLoc = glGetUniformLocation(shaderProgram, "scale");
-        glUniform2fv(scaleLoc, 1, glm::value_ptr(entity.scale));
-        int positionLoc = glGetUniformLocation(shaderProgram, "position");
-        glUniform2fv(positionLoc, 1, glm::value_ptr(entity.position));
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+      TracyGpuZone("scene");
+      gpu_pass_scope pass(*gpuTimers, gpu_pass::scene);
+      queue->execute(glState, render_layer::terrain, render_layer::sprites);
     }
-    glBindVertexArray(0);
+    {
+      TracyGpuZone("ui");
+      gpu_pass_scope pass(*gpuTimers, gpu_pass::ui);
+      queue->execute(glState, render_layer::ui, render_layer::ui);
+    }
+
+    const double swapStart = glfwGetTime();
     glfwSwapBuffers(window);
+    timings.swap_ms = (glfwGetTime() - swapStart) * 1000.0;
+    TracyGpuCollect;
+    gpuTimers->collect();
+    timings.gpu_scene_ms = gpuTimers->milliseconds(gpu_pass::scene);
+    timings.gpu_ui_ms = gpuTimers->milliseconds(gpu_pass::ui);
+
+    // ImGui's own draws aren't counted
+    const sprite_batch_stats& spriteStats = sprites->stats();
+    const tilemap_stats& terrainStats = terrain->stats();
+    frame_counters counters = {};
+    counters.draw_calls = queue->stats().draw_calls;
+    counters.draw_items = queue->stats().items;
+    counters.instances = spriteStats.instances + terrainStats.tiles;
+    counters.texture_binds = glState.stats().texture_binds;
+    counters.uniform_uploads = glState.stats().uniform_uploads;
+    counters.skipped_state_changes = glState.stats().skipped;
+    counters.bytes_uploaded = spriteStats.bytes_uploaded + terrainStats.bytes_uploaded + assets->uploaded_bytes();
+    counters.heap_allocations = static_cast<uint32_t>(heap_allocation_count() - heapAllocationsBefore);
+    counters.frame_arena_bytes = frameMemory.current().stats().bytes_in_use;
+    TracyPlot("heap allocations per frame", static_cast<int64_t>(counters.heap_allocations));
+    overlay.record(timings, counters);
+    FrameMark;
   }
 
 
 
   // Clean up after ourselves
+  queue.reset();
+  gpuTimers.reset();
+  terrain.reset();
+  sprites.reset();
+  atlas.reset();
+  assets.reset();
+  destroy_sprite_pipeline(pipeline);
+  shaders.reset();
   ImGui_ImplOpenGL3_Shutdown();
   ImGui_ImplGlfw_Shutdown();
   ImGui::DestroyContext();
@@ -0,0 +1,122 @@
+#include "mapped_file.h"
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+mapped_file::mapped_file(const std::filesystem::path& path)
+{
+#if defined(_WIN32)
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        throw std::runtime_error("Failed to open " + path.string());
+    }
+    LARGE_INTEGER size = {};
+    if (!GetFileSizeEx(file, &size))
+    {
+        CloseHandle(file);
+        throw std::runtime_error("Failed to read the size of " + path.string());
+    }
+    size_ = static_cast<size_t>(size.QuadPart);
+    if (size_ > 0)
+    {
+        // The mapping keeps the file open on its own.
+        mapping_ = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping_)
+        {
+            data_ = static_cast<const std::byte*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+        }
+    }
+    CloseHandle(file);
+    if (size_ > 0 && !data_)
+    {
+        unmap();
+        throw std::runtime_error("Failed to map " + path.string());
+    }
+#else
+    const int file = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (file < 0)
+    {
+        throw std::runtime_error("Failed to open " + path.string());
+    }
+    struct stat info = {};
+    if (fstat(file, &info) != 0)
+    {
+        close(file);
+        throw std::runtime_error("Failed to read the size of " + path.string());
+    }
+    size_ = static_cast<size_t>(info.st_size);
+    if (size_ > 0)
+    {
+        void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, file, 0);
+        if (data == MAP_FAILED)
+        {
+            close(file);
+            size_ = 0;
+            throw std::runtime_error("Failed to map " + path.string());
+        }
+        data_ = static_cast<const std::byte*>(data);
+    }
+    // The mapping keeps the file open on its own.
+    close(file);
+#endif
+}
+
+mapped_file::~mapped_file()
+{
+    unmap();
+}
+
+mapped_file::mapped_file(mapped_file&& other) noexcept
+    : data_(std::exchange(other.data_, nullptr)), size_(std::exchange(other.size_, 0))
+#if defined(_WIN32)
+    , mapping_(std::exchange(other.mapping_, nullptr))
+#endif
+{
+}
+
+mapped_file& mapped_file::operator=(mapped_file&& other) noexcept
+{
+    if (this != &other)
+    {
+        unmap();
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+#if defined(_WIN32)
+        mapping_ = std::exchange(other.mapping_, nullptr);
+#endif
+    }
+    return *this;
+}
+
+void mapped_file::unmap()
+{
+#if defined(_WIN32)
+    if (data_)
+    {
+        UnmapViewOfFile(data_);
+    }
+    if (mapping_)
+    {
+        CloseHandle(mapping_);
+    }
+    mapping_ = nullptr;
+#else
+    if (data_)
+    {
+        munmap(const_cast<std::byte*>(data_), size_);
+    }
+#endif
+    data_ = nullptr;
+    size_ = 0;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstddef>
+#include <filesystem>
+#include <span>
+
+// Read-only memory mapping of a whole file. Pages are loaded by the OS on first access and shared
+// with the page cache, so mapping a large file costs nothing until it is read.
+class mapped_file
+{
+public:
+    mapped_file() = default;
+    // Throws std::runtime_error if the file can't be opened or mapped.
+    explicit mapped_file(const std::filesystem::path& path);
+    ~mapped_file();
+
+    mapped_file(mapped_file&& other) noexcept;
+    mapped_file& operator=(mapped_file&& other) noexcept;
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+
+    // Page aligned; empty for an empty file.
+    std::span<const std::byte> bytes() const { return { data_, size_ }; }
+    const std::byte* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    void unmap();
+
+    const std::byte* data_ = nullptr;
+    size_t size_ = 0;
+#if defined(_WIN32)
+    void* mapping_ = nullptr; // HANDLE
+#endif
+};
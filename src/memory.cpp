@@ -0,0 +1,164 @@
+#include "memory.h"
+#include <atomic>
+#include <cstdlib>
+
+#if defined(_WIN32)
+#include <malloc.h>
+#endif
+
+namespace
+{
+    std::atomic<uint64_t> heap_allocations{ 0 };
+
+    void* counted_malloc(size_t size)
+    {
+        heap_allocations.fetch_add(1, std::memory_order_relaxed);
+        if (void* p = std::malloc(size == 0 ? 1 : size))
+        {
+            return p;
+        }
+        throw std::bad_alloc();
+    }
+
+    void* counted_aligned_malloc(size_t size, size_t alignment)
+    {
+        heap_allocations.fetch_add(1, std::memory_order_relaxed);
+#if defined(_WIN32)
+        void* p = _aligned_malloc(size == 0 ? 1 : size, alignment);
+#else
+        // aligned_alloc wants the size to be a multiple of the alignment.
+        void* p = std::aligned_alloc(alignment, (std::max<size_t>(size, 1) + alignment - 1) / alignment * alignment);
+#endif
+        if (!p)
+        {
+            throw std::bad_alloc();
+        }
+        return p;
+    }
+
+    void aligned_free(void* p)
+    {
+#if defined(_WIN32)
+        _aligned_free(p);
+#else
+        std::free(p);
+#endif
+    }
+}
+
+// Replacing the global operators is the only portable way to see every allocation the game makes.
+// The array and nothrow forms forward to these.
+void* operator new(size_t size)
+{
+    return counted_malloc(size);
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+    return counted_aligned_malloc(size, static_cast<size_t>(alignment));
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept
+{
+    aligned_free(p);
+}
+
+void operator delete(void* p, size_t, std::align_val_t) noexcept
+{
+    aligned_free(p);
+}
+
+uint64_t heap_allocation_count()
+{
+    return heap_allocations.load(std::memory_order_relaxed);
+}
+
+frame_arena::frame_arena(const char* name, size_t block_size)
+    : name_(name), block_size_(block_size)
+{
+}
+
+frame_arena::~frame_arena()
+{
+    for (const block& b : blocks_)
+    {
+        TracyFreeN(b.data, name_);
+        ::operator delete(b.data, std::align_val_t{ alignof(std::max_align_t) });
+    }
+}
+
+void* frame_arena::allocate(size_t size, size_t alignment)
+{
+    // Move on to the next block (allocating it if need be) until the request fits.
+    for (;;)
+    {
+        if (current_ < blocks_.size())
+        {
+            const block& b = blocks_[current_];
+            const auto base = reinterpret_cast<uintptr_t>(b.data);
+            const size_t aligned = ((base + offset_ + alignment - 1) & ~(alignment - 1)) - base;
+            if (aligned + size <= b.size)
+            {
+                offset_ = aligned + size;
+                stats_.allocations++;
+                stats_.bytes_in_use += size;
+                stats_.high_water = std::max(stats_.high_water, stats_.bytes_in_use);
+                return b.data + aligned;
+            }
+            if (current_ + 1 < blocks_.size())
+            {
+                current_++;
+                offset_ = 0;
+                continue;
+            }
+        }
+        // Oversized requests get a block of their own; alignment beyond max_align_t is padded for.
+        const size_t bytes = std::max(block_size_, size + alignment);
+        auto* data = static_cast<std::byte*>(::operator new(bytes, std::align_val_t{ alignof(std::max_align_t) }));
+        TracyAllocN(data, bytes, name_);
+        blocks_.push_back({ data, bytes });
+        current_ = blocks_.size() - 1;
+        offset_ = 0;
+    }
+}
+
+void frame_arena::reset()
+{
+    current_ = 0;
+    offset_ = 0;
+    stats_.bytes_in_use = 0;
+}
+
+size_t frame_arena::capacity() const
+{
+    size_t total = 0;
+    for (const block& b : blocks_)
+    {
+        total += b.size;
+    }
+    return total;
+}
+
+frame_memory::frame_memory(size_t block_size)
+    : arenas_{ frame_arena("frame arena A", block_size), frame_arena("frame arena B", block_size) }
+{
+}
+
+void frame_memory::begin_frame()
+{
+    // Report the frame that just ended before its arena is reused.
+    TracyPlot("frame arena bytes", static_cast<int64_t>(current().stats().bytes_in_use));
+    TracyPlot("frame arena high water", static_cast<int64_t>(current().stats().high_water));
+    index_ ^= 1;
+    arenas_[index_].reset();
+}
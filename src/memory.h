@@ -0,0 +1,198 @@
+#pragma once
+#include <tracy/Tracy.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Allocation counts for one arena or pool. Mirrored into Tracy's memory view under the owner's name.
+struct allocation_stats
+{
+    uint64_t allocations;  // since construction
+    size_t bytes_in_use;
+    size_t high_water;     // most bytes ever in use at once
+};
+
+// Number of calls to the global operator new so far, from any thread. Memory the C library, GL
+// driver or ImGui get from malloc directly isn't counted.
+uint64_t heap_allocation_count();
+
+// Bump allocator for data that only lives for one frame. Allocating is a pointer increment and
+// reset() releases everything at once without freeing the underlying blocks, so once the arena has
+// grown to a frame's working set it never touches the heap again. Not thread safe.
+class frame_arena
+{
+public:
+    static constexpr size_t default_block_size = 1 << 20;
+
+    // `name` labels the arena's blocks in Tracy and must outlive the arena.
+    explicit frame_arena(const char* name, size_t block_size = default_block_size);
+    ~frame_arena();
+
+    frame_arena(const frame_arena&) = delete;
+    frame_arena& operator=(const frame_arena&) = delete;
+
+    // `alignment` must be a power of two.
+    void* allocate(size_t size, size_t alignment);
+
+    // Uninitialized storage for `count` objects. Destructors are never run, hence the restriction.
+    template<typename T>
+    std::span<T> allocate_array(size_t count)
+    {
+        static_assert(std::is_trivially_destructible_v<T>, "frame_arena never runs destructors");
+        return { static_cast<T*>(allocate(sizeof(T) * count, alignof(T))), count };
+    }
+
+    void reset();
+
+    const allocation_stats& stats() const { return stats_; }
+    size_t capacity() const;
+
+private:
+    struct block
+    {
+        std::byte* data;
+        size_t size;
+    };
+
+    const char* name_;
+    size_t block_size_;
+    std::vector<block> blocks_;
+    size_t current_ = 0; // block being bumped
+    size_t offset_ = 0;  // into blocks_[current_]
+    allocation_stats stats_ = {};
+};
+
+// Two frame_arenas used on alternate frames. Data allocated during a frame stays valid through the
+// next one, so it can still be read after the simulation has moved on (e.g. by rendering).
+class frame_memory
+{
+public:
+    explicit frame_memory(size_t block_size = frame_arena::default_block_size);
+
+    // Call at the top of the game loop. Switches to the other arena and resets it.
+    void begin_frame();
+
+    frame_arena& current() { return arenas_[index_]; }
+    const frame_arena& previous() const { return arenas_[index_ ^ 1]; }
+
+private:
+    frame_arena arenas_[2];
+    uint32_t index_ = 0;
+};
+
+// STL allocator drawing from a frame_arena. deallocate() is a no-op, so a container that grows
+// leaves its old buffers in the arena until the next reset.
+template<typename T>
+class arena_allocator
+{
+public:
+    using value_type = T;
+
+    explicit arena_allocator(frame_arena& arena) : arena_(&arena) {}
+    template<typename U>
+    arena_allocator(const arena_allocator<U>& other) : arena_(other.arena()) {}
+
+    T* allocate(size_t count) { return static_cast<T*>(arena_->allocate(sizeof(T) * count, alignof(T))); }
+    void deallocate(T*, size_t) {}
+
+    frame_arena* arena() const { return arena_; }
+
+    template<typename U>
+    bool operator==(const arena_allocator<U>& other) const { return arena_ == other.arena(); }
+
+private:
+    frame_arena* arena_;
+};
+
+template<typename T>
+using arena_vector = std::vector<T, arena_allocator<T>>;
+
+// Fixed-size blocks for objects of type T, carved out of pages of `page_blocks` blocks. Freed
+// blocks go on a free list and are handed out again before a new page is allocated; pages are only
+// returned to the heap when the pool is destroyed. Not thread safe.
+template<typename T, size_t page_blocks = 64>
+class pool
+{
+public:
+    // `name` labels the pool's objects in Tracy and must outlive the pool.
+    explicit pool(const char* name) : name_(name) {}
+
+    ~pool()
+    {
+        for (void* page : pages_)
+        {
+            ::operator delete(page, std::align_val_t{ alignof(slot) });
+        }
+    }
+
+    pool(const pool&) = delete;
+    pool& operator=(const pool&) = delete;
+
+    // Uninitialized storage for one T.
+    T* allocate()
+    {
+        if (!free_)
+        {
+            grow();
+        }
+        slot* s = free_;
+        free_ = s->next;
+        stats_.allocations++;
+        stats_.bytes_in_use += sizeof(T);
+        stats_.high_water = std::max(stats_.high_water, stats_.bytes_in_use);
+        T* object = reinterpret_cast<T*>(s->storage);
+        TracyAllocN(object, sizeof(T), name_);
+        return object;
+    }
+
+    void deallocate(T* object)
+    {
+        TracyFreeN(object, name_);
+        slot* s = reinterpret_cast<slot*>(object);
+        s->next = free_;
+        free_ = s;
+        stats_.bytes_in_use -= sizeof(T);
+    }
+
+    template<typename... Args>
+    T* create(Args&&... args)
+    {
+        return new (allocate()) T(std::forward<Args>(args)...);
+    }
+
+    void destroy(T* object)
+    {
+        object->~T();
+        deallocate(object);
+    }
+
+    const allocation_stats& stats() const { return stats_; }
+
+private:
+    union slot
+    {
+        slot* next;
+        alignas(T) std::byte storage[sizeof(T)];
+    };
+
+    void grow()
+    {
+        auto* page = static_cast<slot*>(::operator new(sizeof(slot) * page_blocks, std::align_val_t{ alignof(slot) }));
+        pages_.push_back(page);
+        for (size_t i = page_blocks; i-- > 0;)
+        {
+            page[i].next = free_;
+            free_ = &page[i];
+        }
+    }
+
+    const char* name_;
+    std::vector<void*> pages_;
+    slot* free_ = nullptr;
+    allocation_stats stats_ = {};
+};
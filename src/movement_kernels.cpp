@@ -0,0 +1,263 @@
+#include "movement_kernels.h"
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define GAME_SIMD_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+// GCC and Clang only emit instructions the whole translation unit is built for, unless a function
+// asks for more. MSVC always accepts the intrinsics; the caller checks the CPU first either way.
+#if defined(__GNUC__)
+#define GAME_TARGET(isa) __attribute__((target(isa)))
+#else
+#define GAME_TARGET(isa)
+#endif
+
+namespace
+{
+    // Entities [first, batch.count). Also finishes the entities left over by the SIMD kernels.
+    void move_scalar(const movement_batch& batch, const movement_params& params, uint32_t first)
+    {
+        const float pull_scale = params.acceleration * params.dt;
+        const float max_speed2 = params.max_speed * params.max_speed;
+        for (uint32_t i = first; i < batch.count; i++)
+        {
+            float* p = batch.positions + 2 * i;
+            float* v = batch.velocities + 2 * i;
+            const float* s = batch.scales + 2 * i;
+
+            const float dx = params.target.x - p[0];
+            const float dy = params.target.y - p[1];
+            const float distance2 = dx * dx + dy * dy;
+            const float pull = distance2 > 0.0f ? 1.0f / std::sqrt(distance2) * pull_scale : 0.0f;
+            v[0] += dx * pull;
+            v[1] += dy * pull;
+
+            const float speed2 = v[0] * v[0] + v[1] * v[1];
+            if (speed2 > max_speed2)
+            {
+                const float slow_down = params.max_speed / std::sqrt(speed2);
+                v[0] *= slow_down;
+                v[1] *= slow_down;
+            }
+
+            for (int axis = 0; axis < 2; axis++)
+            {
+                p[axis] += v[axis] * params.dt;
+                const float half = s[axis] * 0.5f;
+                if (p[axis] - half < params.bounds.min[axis])
+                {
+                    p[axis] = params.bounds.min[axis] + half;
+                    v[axis] = std::abs(v[axis]);
+                }
+                else if (p[axis] + half > params.bounds.max[axis])
+                {
+                    p[axis] = params.bounds.max[axis] - half;
+                    v[axis] = -std::abs(v[axis]);
+                }
+            }
+        }
+    }
+
+#if GAME_SIMD_X86
+    // Two entities per register: x0 y0 x1 y1. SSE2 has no blend, so selects are and/andnot/or.
+    GAME_TARGET("sse2") inline __m128 select_sse2(__m128 mask, __m128 if_set, __m128 if_clear)
+    {
+        return _mm_or_ps(_mm_and_ps(mask, if_set), _mm_andnot_ps(mask, if_clear));
+    }
+
+    GAME_TARGET("sse2") void move_sse2(const movement_batch& batch, const movement_params& params)
+    {
+        const __m128 dt = _mm_set1_ps(params.dt);
+        const __m128 target = _mm_setr_ps(params.target.x, params.target.y, params.target.x, params.target.y);
+        const __m128 pull_scale = _mm_set1_ps(params.acceleration * params.dt);
+        const __m128 max_speed = _mm_set1_ps(params.max_speed);
+        const __m128 max_speed2 = _mm_set1_ps(params.max_speed * params.max_speed);
+        const __m128 lo = _mm_setr_ps(params.bounds.min.x, params.bounds.min.y, params.bounds.min.x, params.bounds.min.y);
+        const __m128 hi = _mm_setr_ps(params.bounds.max.x, params.bounds.max.y, params.bounds.max.x, params.bounds.max.y);
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 half_of = _mm_set1_ps(0.5f);
+        const __m128 sign = _mm_set1_ps(-0.0f);
+
+        uint32_t i = 0;
+        for (; i + 2 <= batch.count; i += 2)
+        {
+            __m128 p = _mm_loadu_ps(batch.positions + 2 * i);
+            __m128 v = _mm_loadu_ps(batch.velocities + 2 * i);
+            const __m128 s = _mm_loadu_ps(batch.scales + 2 * i);
+
+            // x*x + y*y in both lanes of an entity: add each lane to its neighbour.
+            const __m128 d = _mm_sub_ps(target, p);
+            const __m128 d2 = _mm_mul_ps(d, d);
+            const __m128 distance2 = _mm_add_ps(d2, _mm_shuffle_ps(d2, d2, _MM_SHUFFLE(2, 3, 0, 1)));
+            const __m128 inverse = _mm_and_ps(_mm_cmpgt_ps(distance2, zero), _mm_div_ps(one, _mm_sqrt_ps(distance2)));
+            v = _mm_add_ps(v, _mm_mul_ps(d, _mm_mul_ps(inverse, pull_scale)));
+
+            const __m128 v2 = _mm_mul_ps(v, v);
+            const __m128 speed2 = _mm_add_ps(v2, _mm_shuffle_ps(v2, v2, _MM_SHUFFLE(2, 3, 0, 1)));
+            const __m128 too_fast = _mm_cmpgt_ps(speed2, max_speed2);
+            v = select_sse2(too_fast, _mm_mul_ps(v, _mm_div_ps(max_speed, _mm_sqrt_ps(speed2))), v);
+
+            p = _mm_add_ps(p, _mm_mul_ps(v, dt));
+            const __m128 half = _mm_mul_ps(s, half_of);
+            const __m128 below = _mm_cmplt_ps(_mm_sub_ps(p, half), lo);
+            const __m128 above = _mm_andnot_ps(below, _mm_cmpgt_ps(_mm_add_ps(p, half), hi));
+            p = select_sse2(below, _mm_add_ps(lo, half), select_sse2(above, _mm_sub_ps(hi, half), p));
+            const __m128 speed = _mm_andnot_ps(sign, v);
+            v = select_sse2(below, speed, select_sse2(above, _mm_or_ps(speed, sign), v));
+
+            _mm_storeu_ps(batch.positions + 2 * i, p);
+            _mm_storeu_ps(batch.velocities + 2 * i, v);
+        }
+        move_scalar(batch, params, i);
+    }
+
+    // Same as move_sse2() with four entities per register. Shuffles stay inside each 128-bit half.
+    GAME_TARGET("avx2") void move_avx2(const movement_batch& batch, const movement_params& params)
+    {
+        const __m256 dt = _mm256_set1_ps(params.dt);
+        const __m256 target = _mm256_setr_ps(params.target.x, params.target.y, params.target.x, params.target.y,
+            params.target.x, params.target.y, params.target.x, params.target.y);
+        const __m256 pull_scale = _mm256_set1_ps(params.acceleration * params.dt);
+        const __m256 max_speed = _mm256_set1_ps(params.max_speed);
+        const __m256 max_speed2 = _mm256_set1_ps(params.max_speed * params.max_speed);
+        const __m256 lo = _mm256_setr_ps(params.bounds.min.x, params.bounds.min.y, params.bounds.min.x, params.bounds.min.y,
+            params.bounds.min.x, params.bounds.min.y, params.bounds.min.x, params.bounds.min.y);
+        const __m256 hi = _mm256_setr_ps(params.bounds.max.x, params.bounds.max.y, params.bounds.max.x, params.bounds.max.y,
+            params.bounds.max.x, params.bounds.max.y, params.bounds.max.x, params.bounds.max.y);
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 one = _mm256_set1_ps(1.0f);
+        const __m256 half_of = _mm256_set1_ps(0.5f);
+        const __m256 sign = _mm256_set1_ps(-0.0f);
+
+        uint32_t i = 0;
+        for (; i + 4 <= batch.count; i += 4)
+        {
+            __m256 p = _mm256_loadu_ps(batch.positions + 2 * i);
+            __m256 v = _mm256_loadu_ps(batch.velocities + 2 * i);
+            const __m256 s = _mm256_loadu_ps(batch.scales + 2 * i);
+
+            const __m256 d = _mm256_sub_ps(target, p);
+            const __m256 d2 = _mm256_mul_ps(d, d);
+            const __m256 distance2 = _mm256_add_ps(d2, _mm256_permute_ps(d2, _MM_SHUFFLE(2, 3, 0, 1)));
+            const __m256 inverse = _mm256_and_ps(_mm256_cmp_ps(distance2, zero, _CMP_GT_OQ), _mm256_div_ps(one, _mm256_sqrt_ps(distance2)));
+            v = _mm256_add_ps(v, _mm256_mul_ps(d, _mm256_mul_ps(inverse, pull_scale)));
+
+            const __m256 v2 = _mm256_mul_ps(v, v);
+            const __m256 speed2 = _mm256_add_ps(v2, _mm256_permute_ps(v2, _MM_SHUFFLE(2, 3, 0, 1)));
+            const __m256 too_fast = _mm256_cmp_ps(speed2, max_speed2, _CMP_GT_OQ);
+            v = _mm256_blendv_ps(v, _mm256_mul_ps(v, _mm256_div_ps(max_speed, _mm256_sqrt_ps(speed2))), too_fast);
+
+            p = _mm256_add_ps(p, _mm256_mul_ps(v, dt));
+            const __m256 half = _mm256_mul_ps(s, half_of);
+            const __m256 below = _mm256_cmp_ps(_mm256_sub_ps(p, half), lo, _CMP_LT_OQ);
+            const __m256 above = _mm256_andnot_ps(below, _mm256_cmp_ps(_mm256_add_ps(p, half), hi, _CMP_GT_OQ));
+            p = _mm256_blendv_ps(_mm256_blendv_ps(p, _mm256_sub_ps(hi, half), above), _mm256_add_ps(lo, half), below);
+            const __m256 speed = _mm256_andnot_ps(sign, v);
+            v = _mm256_blendv_ps(_mm256_blendv_ps(v, _mm256_or_ps(speed, sign), above), speed, below);
+
+            _mm256_storeu_ps(batch.positions + 2 * i, p);
+            _mm256_storeu_ps(batch.velocities + 2 * i, v);
+        }
+        move_scalar(batch, params, i);
+    }
+
+    void cpuid(uint32_t leaf, uint32_t subleaf, uint32_t registers[4])
+    {
+#if defined(_MSC_VER)
+        int values[4] = {};
+        __cpuidex(values, static_cast<int>(leaf), static_cast<int>(subleaf));
+        for (int i = 0; i < 4; i++)
+        {
+            registers[i] = static_cast<uint32_t>(values[i]);
+        }
+#else
+        __cpuid_count(leaf, subleaf, registers[0], registers[1], registers[2], registers[3]);
+#endif
+    }
+
+    // Which register states the OS saves on a context switch.
+    uint64_t enabled_register_states()
+    {
+#if defined(_MSC_VER)
+        return _xgetbv(0);
+#else
+        uint32_t low = 0;
+        uint32_t high = 0;
+        __asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+        return (static_cast<uint64_t>(high) << 32) | low;
+#endif
+    }
+
+    simd_level query_simd_level()
+    {
+        uint32_t r[4] = {};
+        cpuid(0, 0, r);
+        const uint32_t max_leaf = r[0];
+        cpuid(1, 0, r);
+        const bool sse2 = (r[3] >> 26) & 1;
+        const bool osxsave = (r[2] >> 27) & 1;
+        const bool avx = (r[2] >> 28) & 1;
+        if (!sse2)
+        {
+            return simd_level::scalar;
+        }
+        // AVX needs the OS to save the SSE and AVX register halves.
+        if (!osxsave || !avx || (enabled_register_states() & 0x6) != 0x6 || max_leaf < 7)
+        {
+            return simd_level::sse2;
+        }
+        cpuid(7, 0, r);
+        const bool avx2 = (r[1] >> 5) & 1;
+        return avx2 ? simd_level::avx2 : simd_level::sse2;
+    }
+#endif
+}
+
+simd_level detect_simd_level()
+{
+#if GAME_SIMD_X86
+    static const simd_level level = query_simd_level();
+    return level;
+#else
+    return simd_level::scalar;
+#endif
+}
+
+const char* simd_level_name(simd_level level)
+{
+    switch (level)
+    {
+    case simd_level::scalar: return "scalar";
+    case simd_level::sse2: return "SSE2";
+    case simd_level::avx2: return "AVX2";
+    }
+    return "unknown";
+}
+
+movement_kernel select_movement_kernel(simd_level level)
+{
+#if GAME_SIMD_X86
+    switch (level)
+    {
+    case simd_level::avx2: return move_avx2;
+    case simd_level::sse2: return move_sse2;
+    case simd_level::scalar: break;
+    }
+#else
+    (void)level;
+#endif
+    return move_entities_scalar;
+}
+
+void move_entities_scalar(const movement_batch& batch, const movement_params& params)
+{
+    move_scalar(batch, params, 0);
+}
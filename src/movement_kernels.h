@@ -0,0 +1,44 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <limits>
+#include "spatial_hash.h"
+
+// Entity movement for whole chunks at a time: steer toward a target, integrate, bounce off the
+// world bounds. Component columns of glm::vec2 already are contiguous float lanes (x0 y0 x1 y1 ...),
+// so the SIMD kernels load and store them in place, two entities per SSE register and four per AVX one.
+struct movement_batch
+{
+    uint32_t count;
+    float* positions;  // 2 * count floats
+    float* velocities; // 2 * count floats
+    const float* scales; // 2 * count floats; each box is centered on its position
+};
+
+struct movement_params
+{
+    float dt;
+    aabb bounds;
+    glm::vec2 target;
+    float acceleration = 0.0f; // toward target, in units per second squared; 0 turns steering off
+    float max_speed = std::numeric_limits<float>::infinity(); // faster entities are slowed down after steering
+};
+
+enum class simd_level
+{
+    scalar,
+    sse2,
+    avx2,
+};
+
+// Best level both the CPU and the OS support, detected once.
+simd_level detect_simd_level();
+const char* simd_level_name(simd_level level);
+
+// Every kernel performs the same float operations in the same order as move_entities_scalar().
+using movement_kernel = void (*)(const movement_batch& batch, const movement_params& params);
+
+// Returns the kernel for `level`, or the best one below it that was compiled in.
+movement_kernel select_movement_kernel(simd_level level);
+
+void move_entities_scalar(const movement_batch& batch, const movement_params& params);
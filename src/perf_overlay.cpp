@@ -0,0 +1,65 @@
+#include "perf_overlay.h"
+
+#if GAME_PERF_OVERLAY
+
+#include <imgui.h>
+#include <algorithm>
+#include <cstdio>
+
+namespace
+{
+    // Graphs share a fixed scale so they can be compared at a glance; 33 ms is two frames at 60 Hz.
+    constexpr float graph_max_ms = 33.3f;
+
+    float average(const float* values, uint32_t count)
+    {
+        float total = 0.0f;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            total += values[i];
+        }
+        return count > 0 ? total / static_cast<float>(count) : 0.0f;
+    }
+
+    void plot(const char* label, const float* values, uint32_t count, uint32_t offset)
+    {
+        char overlay[32];
+        std::snprintf(overlay, sizeof(overlay), "avg %.2f ms", average(values, count));
+        ImGui::PlotLines(label, values, static_cast<int>(perf_overlay::history), static_cast<int>(offset), overlay, 0.0f, graph_max_ms, ImVec2(240, 40));
+    }
+}
+
+void perf_overlay::record(const frame_timings& timings, const frame_counters& counters)
+{
+    frame_ms_[next_] = static_cast<float>(timings.frame_ms);
+    update_ms_[next_] = static_cast<float>(timings.update_ms);
+    swap_ms_[next_] = static_cast<float>(timings.swap_ms);
+    gpu_ms_[next_] = static_cast<float>(timings.gpu_scene_ms + timings.gpu_ui_ms);
+    next_ = (next_ + 1) % history;
+    recorded_ = std::min(recorded_ + 1, history);
+    timings_ = timings;
+    counters_ = counters;
+}
+
+void perf_overlay::draw()
+{
+    ImGui::SetNextWindowBgAlpha(0.6f);
+    if (!ImGui::Begin("Performance", nullptr, ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoFocusOnAppearing | ImGuiWindowFlags_NoNav))
+    {
+        ImGui::End();
+        return;
+    }
+    plot("frame", frame_ms_, recorded_, next_);
+    plot("update", update_ms_, recorded_, next_);
+    plot("swap", swap_ms_, recorded_, next_);
+    plot("gpu", gpu_ms_, recorded_, next_);
+    ImGui::Separator();
+    ImGui::Text("gpu scene %.3f ms  ui %.3f ms", timings_.gpu_scene_ms, timings_.gpu_ui_ms);
+    ImGui::Text("draw calls %u  items %u  instances %u", counters_.draw_calls, counters_.draw_items, counters_.instances);
+    ImGui::Text("texture binds %u  uniform uploads %u  skipped %u", counters_.texture_binds, counters_.uniform_uploads, counters_.skipped_state_changes);
+    ImGui::Text("uploaded %.1f KiB", static_cast<double>(counters_.bytes_uploaded) / 1024.0);
+    ImGui::Text("heap allocations %u  frame arena %.1f KiB", counters_.heap_allocations, static_cast<double>(counters_.frame_arena_bytes) / 1024.0);
+    ImGui::End();
+}
+
+#endif
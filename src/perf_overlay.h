@@ -0,0 +1,61 @@
+#pragma once
+#include <cstdint>
+
+// What the renderer did in one frame, summed over every subsystem.
+struct frame_counters
+{
+    uint32_t draw_calls;
+    uint32_t draw_items; // queued; equal state merges several into one draw call
+    uint32_t instances;
+    uint32_t texture_binds;
+    uint32_t uniform_uploads;
+    uint32_t skipped_state_changes; // binds and uploads that would have changed nothing
+    uint64_t bytes_uploaded; // buffer and texture data sent to the GPU
+    uint32_t heap_allocations; // operator new calls from any thread; zero once the game has warmed up
+    uint64_t frame_arena_bytes;
+};
+
+struct frame_timings
+{
+    double frame_ms;  // wall time between the starts of consecutive frames
+    double update_ms; // simulation
+    double swap_ms;   // blocked in glfwSwapBuffers
+    double gpu_scene_ms;
+    double gpu_ui_ms;
+};
+
+#if GAME_PERF_OVERLAY
+
+// Small always-on ImGui window with rolling frame-time graphs and the latest frame's counters.
+// Recording is a handful of stores into fixed ring buffers and drawing is a few plot widgets, so it
+// is cheap enough to keep in release builds; configure with myProject_PERF_OVERLAY=OFF to remove it.
+class perf_overlay
+{
+public:
+    static constexpr uint32_t history = 240;
+
+    void record(const frame_timings& timings, const frame_counters& counters);
+    // Call between ImGui::NewFrame() and ImGui::Render().
+    void draw();
+
+private:
+    float frame_ms_[history] = {};
+    float update_ms_[history] = {};
+    float swap_ms_[history] = {};
+    float gpu_ms_[history] = {};
+    uint32_t next_ = 0;
+    uint32_t recorded_ = 0;
+    frame_timings timings_ = {};
+    frame_counters counters_ = {};
+};
+
+#else
+
+class perf_overlay
+{
+public:
+    void record(const frame_timings&, const frame_counters&) {}
+    void draw() {}
+};
+
+#endif
@@ -0,0 +1,229 @@
+#include "render_queue.h"
+#include <tracy/Tracy.hpp>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+
+namespace
+{
+    constexpr int key_bytes = 8;
+
+    render_layer layer_of(uint64_t key)
+    {
+        return static_cast<render_layer>(key >> 56);
+    }
+
+    void wait_for_fence(GLsync& fence)
+    {
+        if (!fence)
+        {
+            return;
+        }
+        ZoneScopedN("render_queue wait");
+        GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        while (result == GL_TIMEOUT_EXPIRED)
+        {
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1'000'000);
+        }
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+}
+
+uint64_t make_sort_key(render_layer layer, GLuint program, GLuint vao, GLuint texture, uint32_t depth)
+{
+    return static_cast<uint64_t>(layer) << 56
+        | static_cast<uint64_t>(program & 0xFF) << 48
+        | static_cast<uint64_t>(vao & 0xFF) << 40
+        | static_cast<uint64_t>(texture & 0xFFFF) << 24
+        | (depth & 0xFFFFFF);
+}
+
+render_queue::render_queue(uint32_t max_commands)
+    : max_commands_(max_commands)
+{
+    const GLsizeiptr size = static_cast<GLsizeiptr>(sizeof(indirect_command)) * max_commands_ * frames_in_flight;
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glCreateBuffers(1, &buffer_);
+    glNamedBufferStorage(buffer_, size, nullptr, flags);
+    mapped_ = static_cast<indirect_command*>(glMapNamedBufferRange(buffer_, 0, size, flags));
+    if (!mapped_)
+    {
+        throw std::runtime_error("Failed to map indirect command buffer");
+    }
+}
+
+render_queue::~render_queue()
+{
+    for (GLsync& fence : fences_)
+    {
+        if (fence)
+        {
+            glDeleteSync(fence);
+        }
+    }
+    glUnmapNamedBuffer(buffer_);
+    glDeleteBuffers(1, &buffer_);
+}
+
+void render_queue::begin()
+{
+    // Last frame's multi-draws were all issued by now, so one fence covers its region.
+    if (commands_ > 0)
+    {
+        fences_[region_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        region_ = (region_ + 1) % frames_in_flight;
+    }
+    wait_for_fence(fences_[region_]);
+    commands_ = 0;
+    items_.clear();
+    entries_.clear();
+    next_ = 0;
+    sorted_ = false;
+    stats_ = {};
+}
+
+void render_queue::push(render_layer layer, uint32_t depth, const draw_item& item)
+{
+    entries_.push_back({ make_sort_key(layer, item.program, item.vao, item.texture, depth), static_cast<uint32_t>(items_.size()) });
+    items_.push_back({ item, nullptr, nullptr });
+}
+
+void render_queue::push(render_layer layer, uint32_t depth, callback fn, void* context)
+{
+    entries_.push_back({ make_sort_key(layer, 0, 0, 0, depth), static_cast<uint32_t>(items_.size()) });
+    items_.push_back({ {}, fn, context });
+}
+
+void render_queue::sort()
+{
+    ZoneScopedN("render_queue sort");
+    const auto start = std::chrono::steady_clock::now();
+
+    // LSD radix sort, one byte per pass. All histograms come from a single read of the keys, and a
+    // pass where every key has the same byte would only copy, so it is skipped. In practice most of
+    // the key is constant within a frame and only two or three passes run.
+    uint32_t counts[key_bytes][256] = {};
+    for (const sort_entry& entry : entries_)
+    {
+        for (int b = 0; b < key_bytes; b++)
+        {
+            counts[b][(entry.key >> (b * 8)) & 0xFF]++;
+        }
+    }
+    scratch_.resize(entries_.size());
+    const auto total = static_cast<uint32_t>(entries_.size());
+    for (int b = 0; b < key_bytes; b++)
+    {
+        uint32_t* count = counts[b];
+        if (count[(entries_[0].key >> (b * 8)) & 0xFF] == total)
+        {
+            continue;
+        }
+        uint32_t offset = 0;
+        for (int digit = 0; digit < 256; digit++)
+        {
+            const uint32_t n = count[digit];
+            count[digit] = offset;
+            offset += n;
+        }
+        for (const sort_entry& entry : entries_)
+        {
+            scratch_[count[(entry.key >> (b * 8)) & 0xFF]++] = entry;
+        }
+        entries_.swap(scratch_);
+    }
+
+    sorted_ = true;
+    stats_.items = total;
+    stats_.sort_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void render_queue::execute(gl_state& state, render_layer first, render_layer last)
+{
+    ZoneScopedN("render_queue execute");
+    if (entries_.empty())
+    {
+        return;
+    }
+    if (!sorted_)
+    {
+        sort();
+    }
+
+    while (next_ < entries_.size() && layer_of(entries_[next_].key) < first)
+    {
+        next_++;
+    }
+    while (next_ < entries_.size() && layer_of(entries_[next_].key) <= last)
+    {
+        const queued_item& item = items_[entries_[next_].item];
+        if (item.fn)
+        {
+            item.fn(item.context);
+            state.invalidate_bindings();
+            next_++;
+            continue;
+        }
+        // Extend the run while the next item needs exactly the same state.
+        size_t end = next_ + 1;
+        while (end < entries_.size() && layer_of(entries_[end].key) <= last)
+        {
+            const queued_item& other = items_[entries_[end].item];
+            if (other.fn || other.draw.program != item.draw.program || other.draw.vao != item.draw.vao || other.draw.texture != item.draw.texture)
+            {
+                break;
+            }
+            end++;
+        }
+        submit_run(state, entries_.data() + next_, static_cast<uint32_t>(end - next_));
+        next_ = end;
+    }
+
+    TracyPlot("render queue items", static_cast<int64_t>(stats_.items));
+    TracyPlot("render queue draw calls", static_cast<int64_t>(stats_.draw_calls));
+}
+
+void render_queue::submit_run(gl_state& state, const sort_entry* run, uint32_t count)
+{
+    const draw_item& first = items_[run[0].item].draw;
+    state.use_program(first.program);
+    state.bind_vertex_array(first.vao);
+    state.bind_texture(0, first.texture);
+
+    if (count > 1 && max_commands_ - commands_ < count && !overflow_reported_)
+    {
+        std::cout << "render_queue: more than " << max_commands_ << " indirect commands in a frame, drawing the rest one at a time" << std::endl;
+        overflow_reported_ = true;
+    }
+    if (count == 1 || max_commands_ - commands_ < count)
+    {
+        for (uint32_t i = 0; i < count; i++)
+        {
+            const draw_item& item = items_[run[i].item].draw;
+            glDrawElementsInstancedBaseInstance(GL_TRIANGLES, static_cast<GLsizei>(item.index_count), GL_UNSIGNED_INT,
+                reinterpret_cast<const void*>(static_cast<uintptr_t>(item.first_index) * sizeof(uint32_t)),
+                static_cast<GLsizei>(item.instance_count), item.base_instance);
+        }
+        stats_.draw_calls += count;
+        return;
+    }
+
+    const uint32_t first_command = region_ * max_commands_ + commands_;
+    indirect_command* commands = mapped_ + first_command;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const draw_item& item = items_[run[i].item].draw;
+        commands[i] = { item.index_count, item.instance_count, item.first_index, 0, item.base_instance };
+    }
+    commands_ += count;
+
+    state.bind_draw_indirect_buffer(buffer_);
+    glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+        reinterpret_cast<const void*>(static_cast<uintptr_t>(first_command) * sizeof(indirect_command)),
+        static_cast<GLsizei>(count), 0);
+    stats_.draw_calls++;
+    stats_.multi_draws++;
+    stats_.merged += count;
+}
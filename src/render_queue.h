@@ -0,0 +1,116 @@
+#pragma once
+#include <glad/gl.h>
+#include <cstdint>
+#include <vector>
+#include "gl_state.h"
+
+// Layers are drawn in this order; everything in a layer is drawn before the next one starts.
+enum class render_layer : uint8_t
+{
+    terrain,
+    sprites,
+    ui,
+};
+
+// Bits, high to low: layer (8) | program (8) | vertex array (8) | texture (16) | depth (24).
+// Sorting by key groups items by layer first and then by the state they need, so neighbours share
+// as much as possible. Names are truncated to fit, which only costs merges, never correctness: the
+// full names are compared before two items are merged.
+uint64_t make_sort_key(render_layer layer, GLuint program, GLuint vao, GLuint texture, uint32_t depth);
+
+// One instanced draw of GL_UNSIGNED_INT indices from `vao`, with `texture` on unit 0.
+struct draw_item
+{
+    GLuint program;
+    GLuint vao;
+    GLuint texture;
+    uint32_t index_count;
+    uint32_t first_index;
+    uint32_t instance_count;
+    uint32_t base_instance;
+};
+
+struct render_queue_stats
+{
+    uint32_t items;       // queued since begin(), callbacks included
+    uint32_t draw_calls;  // GL draw commands issued; a multi-draw counts once
+    uint32_t multi_draws; // draw_calls that were glMultiDrawElementsIndirect
+    uint32_t merged;      // items drawn as part of a multi-draw
+    double sort_ms;
+};
+
+// Collects a frame's draws, radix-sorts them by key and submits them through a gl_state so
+// redundant binds never reach GL. Runs of sorted items that need the same program, vertex array
+// and texture become one glMultiDrawElementsIndirect; the commands are written into a persistently
+// mapped buffer split into fenced regions, the same way sprite_batch streams instances.
+class render_queue
+{
+public:
+    static constexpr uint32_t frames_in_flight = 3;
+    // Indirect commands per frame. Runs that don't fit are drawn one item at a time instead.
+    static constexpr uint32_t default_max_commands = 1 << 14;
+
+    using callback = void (*)(void* context);
+
+    explicit render_queue(uint32_t max_commands = default_max_commands);
+    ~render_queue();
+
+    render_queue(const render_queue&) = delete;
+    render_queue& operator=(const render_queue&) = delete;
+
+    // Clears the queue and waits until the GPU is done with this frame's indirect commands.
+    void begin();
+    // Lower depths are drawn first among items with the same key otherwise; equal keys keep the
+    // order they were pushed in.
+    void push(render_layer layer, uint32_t depth, const draw_item& item);
+    // Runs `fn` in sorted order, for rendering that doesn't fit a draw_item (ImGui). It may change
+    // any GL state; the gl_state is invalidated afterwards. Never merged with anything.
+    void push(render_layer layer, uint32_t depth, callback fn, void* context);
+
+    // Sorts the queue on the first call after begin(), then submits the items of layers
+    // first..last. Splitting a frame into several calls lets GPU timers wrap separate layers.
+    void execute(gl_state& state, render_layer first, render_layer last);
+
+    const render_queue_stats& stats() const { return stats_; }
+
+private:
+    struct queued_item
+    {
+        draw_item draw;
+        callback fn; // draw is ignored when set
+        void* context;
+    };
+
+    // Layout fixed by glMultiDrawElementsIndirect.
+    struct indirect_command
+    {
+        uint32_t count;
+        uint32_t instance_count;
+        uint32_t first_index;
+        int32_t base_vertex;
+        uint32_t base_instance;
+    };
+
+    struct sort_entry
+    {
+        uint64_t key;
+        uint32_t item;
+    };
+
+    void sort();
+    void submit_run(gl_state& state, const sort_entry* run, uint32_t count);
+
+    GLuint buffer_ = 0;
+    indirect_command* mapped_ = nullptr;
+    uint32_t max_commands_ = 0;
+    uint32_t commands_ = 0; // written to the current region since begin()
+    uint32_t region_ = 0;
+    GLsync fences_[frames_in_flight] = {};
+    std::vector<queued_item> items_;
+    std::vector<sort_entry> entries_;
+    std::vector<sort_entry> scratch_;
+    size_t next_ = 0; // first sorted entry not submitted yet
+    bool sorted_ = false;
+    render_queue_stats stats_ = {};
+    bool overflow_reported_ = false;
+};
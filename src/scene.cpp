@@ -0,0 +1,39 @@
+#include "scene.h"
+#include <tracy/Tracy.hpp>
+#include <random>
+
+void spawn_stress_slimes(entity_registry& registry, std::vector<entity_handle>& slimes, sprite_handle image, int count, const aabb& area)
+{
+    ZoneScoped;
+    for (entity_handle slime : slimes)
+    {
+        registry.destroy(slime);
+    }
+    slimes.clear();
+    std::mt19937 rng(1337);
+    std::uniform_real_distribution<float> x(area.min.x, area.max.x);
+    std::uniform_real_distribution<float> y(area.min.y, area.max.y);
+    std::uniform_real_distribution<float> speed(-80, 80);
+    // Separate stream, so the animation doesn't change where slimes are placed.
+    std::mt19937 animation_rng(7331);
+    std::uniform_real_distribution<float> clip_start(-10.0f, 0.0f);
+    std::uniform_real_distribution<float> clip_speed(0.75f, 1.25f);
+    for (int i = 0; i < count; i++)
+    {
+        const sprite look = { image, clip_start(animation_rng), clip_speed(animation_rng) };
+        slimes.push_back(create_slime_entity(registry, look, x(rng), y(rng), { speed(rng), speed(rng) }));
+    }
+}
+
+void fill_terrain(tilemap& map, sprite_handle image, uint32_t count)
+{
+    ZoneScoped;
+    map.clear();
+    for (uint32_t y = 0; y < map.height() && count > 0; y++)
+    {
+        for (uint32_t x = y % 2; x < map.width() && count > 0; x += 2, count--)
+        {
+            map.set_tile(x, y, image);
+        }
+    }
+}
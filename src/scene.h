@@ -0,0 +1,14 @@
+#pragma once
+#include <vector>
+#include "entity.h"
+#include "spatial_hash.h"
+#include "tilemap.h"
+
+// Content generators for the stress scene and the benchmarks. Placement is seeded, so the same
+// arguments always produce the same scene. Content created by a previous call is removed first.
+
+// Slimes at random positions inside `area`, moving in random directions. Animated sprites start at
+// random points in their clip and play at slightly different speeds, so the crowd isn't in lockstep.
+void spawn_stress_slimes(entity_registry& registry, std::vector<entity_handle>& slimes, sprite_handle image, int count, const aabb& area);
+// `count` terrain tiles on a checkerboard, filling the map row by row from the top left.
+void fill_terrain(tilemap& map, sprite_handle image, uint32_t count);
@@ -0,0 +1,381 @@
+#include "scene_file.h"
+#include <tracy/Tracy.hpp>
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include "hash.h"
+#include "tilemap.h"
+
+namespace
+{
+    constexpr char scene_magic[8] = { '2', 'D', 'S', 'C', 'E', 'N', 'E', '\0' };
+
+    static_assert(sizeof(position) == 8 && sizeof(velocity) == 8 && sizeof(scale) == 8 && sizeof(sprite) == 12,
+        "scene columns store components as they are laid out in memory");
+
+    // Appends to the file while keeping track of the offset and the checksum of everything written.
+    class scene_writer
+    {
+    public:
+        explicit scene_writer(const std::filesystem::path& path)
+            : out_(path, std::ios::binary | std::ios::trunc)
+        {
+            if (!out_)
+            {
+                throw std::runtime_error("Failed to open " + path.string() + " for writing");
+            }
+            // Placeholder until the offsets and the checksum are known.
+            const scene_file_header header = {};
+            out_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        }
+
+        uint64_t offset() const { return offset_; }
+        uint64_t checksum() const { return checksum_; }
+
+        void write(const void* data, size_t size)
+        {
+            out_.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+            checksum_ = fnv1a64(data, size, checksum_);
+            offset_ += size;
+        }
+
+        // Pads to the next array boundary and returns the offset of the array that follows.
+        uint64_t align()
+        {
+            static constexpr std::byte zeros[scene_file_alignment] = {};
+            write(zeros, static_cast<size_t>((scene_file_alignment - offset_ % scene_file_alignment) % scene_file_alignment));
+            return offset_;
+        }
+
+        void finish(const scene_file_header& header)
+        {
+            out_.seekp(0);
+            out_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            out_.flush();
+            if (!out_)
+            {
+                throw std::runtime_error("Failed to write scene file");
+            }
+        }
+
+    private:
+        std::ofstream out_;
+        uint64_t offset_ = sizeof(scene_file_header);
+        uint64_t checksum_ = fnv1a_seed;
+    };
+
+    // Writes one column of every entity with the components Ts..., Tags... and returns its offset.
+    template<typename T, typename... Ts, typename... Tags>
+    uint64_t write_column(scene_writer& writer, entity_registry& registry, with<Tags...> tags)
+    {
+        const uint64_t offset = writer.align();
+        registry.each_chunk<T, Ts...>(tags, [&writer](uint32_t count, const entity_handle*, const T* column, const Ts*...)
+        {
+            writer.write(column, sizeof(T) * count);
+        });
+        return offset;
+    }
+
+    template<typename... Ts, typename... Tags>
+    uint32_t count_entities(entity_registry& registry, with<Tags...> tags)
+    {
+        uint32_t total = 0;
+        registry.each_chunk<Ts...>(tags, [&total](uint32_t count, const entity_handle*, const Ts*...) { total += count; });
+        return total;
+    }
+
+    void check_range(const scene_file_header& header, uint64_t offset, uint64_t size, const char* what)
+    {
+        if (offset % scene_file_alignment != 0 || offset < sizeof(scene_file_header) || offset > header.file_size ||
+            size > header.file_size - offset)
+        {
+            throw std::runtime_error(std::string("Scene file is corrupt: bad ") + what + " range");
+        }
+    }
+
+    // Chunks needed to cover `tiles` tiles. In 64 bits, so sizes near UINT32_MAX can't wrap.
+    uint64_t chunk_count(uint32_t tiles, uint32_t chunk_size)
+    {
+        return (uint64_t{ tiles } + chunk_size - 1) / chunk_size;
+    }
+
+    sprite_handle resolve(std::span<const sprite_handle> asset_handles, uint32_t asset)
+    {
+        if (asset >= asset_handles.size())
+        {
+            throw std::runtime_error("Scene file refers to a missing asset");
+        }
+        return asset_handles[asset];
+    }
+}
+
+void export_scene(const std::filesystem::path& path, entity_registry& registry, const scene_tiles& terrain, std::span<const std::string> asset_names)
+{
+    ZoneScoped;
+    scene_writer writer(path);
+    scene_file_header header = {};
+    std::memcpy(header.magic, scene_magic, sizeof(scene_magic));
+    header.version = scene_file_version;
+    header.header_size = sizeof(scene_file_header);
+
+    header.asset_count = static_cast<uint32_t>(asset_names.size());
+    header.assets_offset = writer.align();
+    uint32_t name_offset = 0;
+    for (const std::string& name : asset_names)
+    {
+        const scene_asset asset = { name_offset, static_cast<uint32_t>(name.size()) };
+        writer.write(&asset, sizeof(asset));
+        name_offset += asset.name_size;
+    }
+    header.names_offset = writer.align();
+    for (const std::string& name : asset_names)
+    {
+        writer.write(name.data(), name.size());
+    }
+    header.names_size = name_offset;
+
+    // Players don't move on their own, so they have no velocity column.
+    scene_entity_group groups[2] = {};
+    groups[0].kind = scene_entity_kind::player;
+    groups[0].count = count_entities<position, scale, sprite>(registry, with<player_tag>{});
+    groups[0].positions = write_column<position, scale, sprite>(writer, registry, with<player_tag>{});
+    groups[0].scales = write_column<scale, position, sprite>(writer, registry, with<player_tag>{});
+    groups[0].sprites = write_column<sprite, position, scale>(writer, registry, with<player_tag>{});
+    groups[1].kind = scene_entity_kind::slime;
+    groups[1].count = count_entities<position, velocity, scale, sprite>(registry, with<slime_tag>{});
+    groups[1].positions = write_column<position, velocity, scale, sprite>(writer, registry, with<slime_tag>{});
+    groups[1].velocities = write_column<velocity, position, scale, sprite>(writer, registry, with<slime_tag>{});
+    groups[1].scales = write_column<scale, position, velocity, sprite>(writer, registry, with<slime_tag>{});
+    groups[1].sprites = write_column<sprite, position, velocity, scale>(writer, registry, with<slime_tag>{});
+    header.group_count = 2;
+    header.groups_offset = writer.align();
+    writer.write(groups, sizeof(groups));
+
+    header.map_width = terrain.width;
+    header.map_height = terrain.height;
+    header.tile_size = terrain.tile_size;
+    header.chunk_size = tilemap::chunk_size;
+    header.tiles_offset = writer.align();
+    std::array<uint32_t, tilemap::chunk_tiles> chunk;
+    for (uint32_t chunk_y = 0; chunk_y * tilemap::chunk_size < terrain.height; chunk_y++)
+    {
+        for (uint32_t chunk_x = 0; chunk_x * tilemap::chunk_size < terrain.width; chunk_x++)
+        {
+            chunk.fill(scene_empty_tile);
+            for (uint32_t y = 0; y < tilemap::chunk_size; y++)
+            {
+                for (uint32_t x = 0; x < tilemap::chunk_size; x++)
+                {
+                    const uint32_t map_x = chunk_x * tilemap::chunk_size + x;
+                    const uint32_t map_y = chunk_y * tilemap::chunk_size + y;
+                    if (map_x < terrain.width && map_y < terrain.height)
+                    {
+                        chunk[y * tilemap::chunk_size + x] = terrain.tiles[static_cast<size_t>(map_y) * terrain.width + map_x];
+                    }
+                }
+            }
+            writer.write(chunk.data(), sizeof(chunk));
+        }
+    }
+
+    header.file_size = writer.offset();
+    header.checksum = writer.checksum();
+    writer.finish(header);
+}
+
+scene_file::scene_file(const std::filesystem::path& path, bool verify_checksum)
+    : file_(path)
+{
+    ZoneScoped;
+    if (file_.size() < sizeof(scene_file_header))
+    {
+        throw std::runtime_error("Not a scene file: " + path.string());
+    }
+    header_ = at<scene_file_header>(0);
+    const scene_file_header& h = *header_;
+    if (std::memcmp(h.magic, scene_magic, sizeof(scene_magic)) != 0)
+    {
+        throw std::runtime_error("Not a scene file: " + path.string());
+    }
+    if (h.version != scene_file_version || h.header_size != sizeof(scene_file_header))
+    {
+        throw std::runtime_error("Unsupported scene file version in " + path.string());
+    }
+    if (h.file_size != file_.size())
+    {
+        throw std::runtime_error("Scene file is truncated: " + path.string());
+    }
+
+    check_range(h, h.assets_offset, uint64_t{ h.asset_count } * sizeof(scene_asset), "asset table");
+    check_range(h, h.names_offset, h.names_size, "asset name");
+    for (uint32_t i = 0; i < h.asset_count; i++)
+    {
+        const scene_asset& asset = at<scene_asset>(h.assets_offset)[i];
+        if (uint64_t{ asset.name_offset } + asset.name_size > h.names_size)
+        {
+            throw std::runtime_error("Scene file is corrupt: bad asset name range");
+        }
+    }
+    check_range(h, h.groups_offset, uint64_t{ h.group_count } * sizeof(scene_entity_group), "entity group");
+    for (const scene_entity_group& group : groups())
+    {
+        if (group.kind != scene_entity_kind::player && group.kind != scene_entity_kind::slime)
+        {
+            throw std::runtime_error("Scene file is corrupt: unknown entity kind");
+        }
+        check_range(h, group.positions, uint64_t{ group.count } * sizeof(position), "position column");
+        check_range(h, group.scales, uint64_t{ group.count } * sizeof(scale), "scale column");
+        check_range(h, group.sprites, uint64_t{ group.count } * sizeof(sprite), "sprite column");
+        if (group.kind == scene_entity_kind::slime)
+        {
+            check_range(h, group.velocities, uint64_t{ group.count } * sizeof(velocity), "velocity column");
+        }
+    }
+    if (h.map_width > 0 && h.map_height > 0)
+    {
+        if (h.chunk_size == 0)
+        {
+            throw std::runtime_error("Scene file is corrupt: zero tile chunk size");
+        }
+        // Both padded sides fit in 33 bits, but their product doesn't have to fit in anything.
+        const uint64_t padded_width = chunk_count(h.map_width, h.chunk_size) * h.chunk_size;
+        const uint64_t padded_height = chunk_count(h.map_height, h.chunk_size) * h.chunk_size;
+        if (padded_width > std::numeric_limits<size_t>::max() / sizeof(uint32_t) / padded_height)
+        {
+            throw std::runtime_error("Scene file is corrupt: terrain is too large");
+        }
+        check_range(h, h.tiles_offset, padded_width * padded_height * sizeof(uint32_t), "tile");
+    }
+
+    if (verify_checksum)
+    {
+        ZoneScopedN("scene checksum");
+        if (fnv1a64(file_.data() + sizeof(scene_file_header), file_.size() - sizeof(scene_file_header)) != h.checksum)
+        {
+            throw std::runtime_error("Scene file checksum mismatch: " + path.string());
+        }
+    }
+}
+
+std::string_view scene_file::asset_name(uint32_t asset) const
+{
+    const scene_asset& entry = at<scene_asset>(header_->assets_offset)[asset];
+    return { at<char>(header_->names_offset) + entry.name_offset, entry.name_size };
+}
+
+size_t scene_file::entity_count() const
+{
+    size_t count = 0;
+    for (const scene_entity_group& group : groups())
+    {
+        count += group.count;
+    }
+    return count;
+}
+
+std::span<const uint32_t> scene_file::tile_chunk(uint32_t chunk_x, uint32_t chunk_y) const
+{
+    const uint64_t chunks_x = chunk_count(header_->map_width, header_->chunk_size);
+    const size_t chunk_tiles = static_cast<size_t>(header_->chunk_size) * header_->chunk_size;
+    return { at<uint32_t>(header_->tiles_offset) + static_cast<size_t>(chunk_y * chunks_x + chunk_x) * chunk_tiles, chunk_tiles };
+}
+
+std::vector<sprite_handle> scene_file::resolve_assets(const texture_atlas& atlas) const
+{
+    std::vector<sprite_handle> handles(asset_count());
+    for (uint32_t i = 0; i < asset_count(); i++)
+    {
+        handles[i] = atlas.find(asset_name(i));
+    }
+    return handles;
+}
+
+void scene_file::instantiate(entity_registry& registry, std::span<const sprite_handle> asset_handles) const
+{
+    ZoneScoped;
+    for (const scene_entity_group& group : groups())
+    {
+        const position* positions = at<position>(group.positions);
+        const scale* scales = at<scale>(group.scales);
+        const sprite* sprites = at<sprite>(group.sprites);
+        // Columns are copied a chunk at a time; only sprite handles need translating.
+        auto copy_sprites = [&](uint32_t first, uint32_t count, sprite* out)
+        {
+            std::memcpy(out, sprites + first, sizeof(sprite) * count);
+            for (uint32_t i = 0; i < count; i++)
+            {
+                out[i].handle = resolve(asset_handles, out[i].handle);
+            }
+        };
+        if (group.kind == scene_entity_kind::player)
+        {
+            registry.create_many<position, previous_position, scale, sprite>(with<player_tag>{}, group.count,
+                [&](uint32_t first, uint32_t count, position* p, previous_position* prev, scale* s, sprite* t)
+            {
+                std::memcpy(p, positions + first, sizeof(position) * count);
+                for (uint32_t i = 0; i < count; i++)
+                {
+                    prev[i].value = p[i].value;
+                }
+                std::memcpy(s, scales + first, sizeof(scale) * count);
+                copy_sprites(first, count, t);
+            });
+        }
+        else
+        {
+            const velocity* velocities = at<velocity>(group.velocities);
+            registry.create_many<position, previous_position, velocity, scale, sprite>(with<slime_tag>{}, group.count,
+                [&](uint32_t first, uint32_t count, position* p, previous_position* prev, velocity* v, scale* s, sprite* t)
+            {
+                std::memcpy(p, positions + first, sizeof(position) * count);
+                for (uint32_t i = 0; i < count; i++)
+                {
+                    prev[i].value = p[i].value;
+                }
+                std::memcpy(v, velocities + first, sizeof(velocity) * count);
+                std::memcpy(s, scales + first, sizeof(scale) * count);
+                copy_sprites(first, count, t);
+            });
+        }
+    }
+}
+
+void scene_file::load_tiles(tilemap& map, std::span<const sprite_handle> asset_handles) const
+{
+    ZoneScoped;
+    if (map.width() != header_->map_width || map.height() != header_->map_height)
+    {
+        throw std::runtime_error("Scene terrain doesn't match the tilemap size");
+    }
+    map.clear();
+    if (header_->map_width == 0 || header_->map_height == 0)
+    {
+        return;
+    }
+    const uint32_t size = header_->chunk_size;
+    const auto chunks_x = static_cast<uint32_t>(chunk_count(header_->map_width, size));
+    const auto chunks_y = static_cast<uint32_t>(chunk_count(header_->map_height, size));
+    for (uint32_t chunk_y = 0; chunk_y < chunks_y; chunk_y++)
+    {
+        for (uint32_t chunk_x = 0; chunk_x < chunks_x; chunk_x++)
+        {
+            const std::span<const uint32_t> tiles = tile_chunk(chunk_x, chunk_y);
+            const uint32_t x0 = chunk_x * size, x1 = static_cast<uint32_t>(std::min<uint64_t>(uint64_t{ x0 } + size, header_->map_width));
+            const uint32_t y0 = chunk_y * size, y1 = static_cast<uint32_t>(std::min<uint64_t>(uint64_t{ y0 } + size, header_->map_height));
+            for (uint32_t y = y0; y < y1; y++)
+            {
+                for (uint32_t x = x0; x < x1; x++)
+                {
+                    const uint32_t asset = tiles[(y - y0) * size + (x - x0)];
+                    if (asset != scene_empty_tile)
+                    {
+                        map.set_tile(x, y, resolve(asset_handles, asset));
+                    }
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,117 @@
+#pragma once
+#include <bit>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "entity.h"
+#include "mapped_file.h"
+
+class tilemap;
+
+// Binary level files. A scene file is memory-mapped and read in place: entity columns are stored
+// exactly as the registry stores components, so loading copies whole columns into entity chunks
+// and never parses or allocates anything per entity.
+//
+// Layout: a scene_file_header, then arrays that each start on a scene_file_alignment boundary.
+// Every value is little-endian. Sprites and tiles refer to assets by index into the file's asset
+// table, and assets are looked up by name when loading, so files survive the atlas changing.
+static_assert(std::endian::native == std::endian::little, "scene files are little-endian and read in place");
+
+constexpr uint32_t scene_file_version = 1;
+constexpr uint64_t scene_file_alignment = 64;
+// Tile value of an empty cell, the same as tilemap::empty_tile.
+constexpr uint32_t scene_empty_tile = UINT32_MAX;
+
+enum class scene_entity_kind : uint32_t
+{
+    player,
+    slime,
+};
+
+struct scene_file_header
+{
+    char magic[8];          // "2DSCENE" and a zero
+    uint32_t version;       // scene_file_version
+    uint32_t header_size;   // sizeof(scene_file_header)
+    uint64_t file_size;
+    uint64_t checksum;      // 64-bit FNV-1a of every byte after the header
+    uint32_t asset_count;
+    uint32_t group_count;
+    uint64_t assets_offset; // scene_asset[asset_count]
+    uint64_t names_offset;  // characters of every asset name, not zero terminated
+    uint64_t names_size;
+    uint64_t groups_offset; // scene_entity_group[group_count]
+    uint32_t map_width;     // in tiles; 0 when the scene has no terrain
+    uint32_t map_height;
+    float tile_size;
+    uint32_t chunk_size;    // tiles are stored as chunk_size x chunk_size chunks
+    uint64_t tiles_offset;  // uint32_t asset indices, one chunk after another, each chunk row by row
+};
+
+struct scene_asset
+{
+    uint32_t name_offset; // into the name characters
+    uint32_t name_size;
+};
+
+// Entities of one kind. Every column holds `count` elements.
+struct scene_entity_group
+{
+    scene_entity_kind kind;
+    uint32_t count;
+    uint64_t positions;  // position[]
+    uint64_t velocities; // velocity[]; 0 for kinds that don't move
+    uint64_t scales;     // scale[]
+    uint64_t sprites;    // sprite[], with the asset index in place of the sprite handle
+};
+
+static_assert(sizeof(scene_file_header) == 96 && sizeof(scene_asset) == 8 && sizeof(scene_entity_group) == 40, "scene file layout");
+
+// Terrain to export, row by row as the tilemap stores it.
+struct scene_tiles
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    float tile_size = 0.0f;
+    std::span<const sprite_handle> tiles;
+};
+
+// Writes every player and slime in `registry` and the terrain to `path`. `asset_names` names every
+// sprite handle in use, e.g. texture_atlas::names(). Throws std::runtime_error on failure.
+void export_scene(const std::filesystem::path& path, entity_registry& registry, const scene_tiles& terrain, std::span<const std::string> asset_names);
+
+class scene_file
+{
+public:
+    // Maps the file and checks that every array lies inside it. With `verify_checksum` the whole
+    // file is also read once and hashed. Throws std::runtime_error when the file isn't a valid scene.
+    explicit scene_file(const std::filesystem::path& path, bool verify_checksum = true);
+
+    const scene_file_header& header() const { return *header_; }
+    uint32_t asset_count() const { return header_->asset_count; }
+    std::string_view asset_name(uint32_t asset) const;
+    std::span<const scene_entity_group> groups() const { return { at<scene_entity_group>(header_->groups_offset), header_->group_count }; }
+    size_t entity_count() const;
+
+    template<typename T>
+    std::span<const T> column(uint64_t offset, uint32_t count) const { return { at<T>(offset), count }; }
+    // Asset indices of one terrain chunk, chunk_size x chunk_size row by row. Tiles past the edge of the map are empty.
+    std::span<const uint32_t> tile_chunk(uint32_t chunk_x, uint32_t chunk_y) const;
+
+    // Sprite handle of every asset, by name. Throws if the atlas is missing one.
+    std::vector<sprite_handle> resolve_assets(const texture_atlas& atlas) const;
+    // Creates every entity in the file. `asset_handles` maps asset indices to sprite handles.
+    void instantiate(entity_registry& registry, std::span<const sprite_handle> asset_handles) const;
+    // Replaces the tiles of `map`, which must have the file's width and height.
+    void load_tiles(tilemap& map, std::span<const sprite_handle> asset_handles) const;
+
+private:
+    template<typename T>
+    const T* at(uint64_t offset) const { return reinterpret_cast<const T*>(file_.data() + offset); }
+
+    mapped_file file_;
+    const scene_file_header* header_ = nullptr;
+};
@@ -0,0 +1,322 @@
+#include "shader_manager.h"
+#include "binary_io.h"
+#include "hash.h"
+#include <stb_include.h>
+#include <tracy/Tracy.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+namespace
+{
+    constexpr uint32_t cache_magic = 0x4e494250; // "PBIN"
+    constexpr uint32_t cache_version = 1;
+
+    // Returns false and fills `error` if the file or one of its includes can't be read.
+    bool preprocess(const std::filesystem::path& file, std::string& source, std::string& error)
+    {
+        char message[256] = {};
+        char* text = stb_include_file(file.string().c_str(), nullptr, file.parent_path().string().c_str(), message);
+        if (!text)
+        {
+            error = message;
+            return false;
+        }
+        source = text;
+        free(text);
+        return true;
+    }
+
+    std::string shader_log(GLuint shader)
+    {
+        GLint length = 0;
+        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+        std::string log(static_cast<size_t>(std::max(length, 1)), '\0');
+        glGetShaderInfoLog(shader, static_cast<GLsizei>(log.size()), &length, log.data());
+        log.resize(static_cast<size_t>(length));
+        return log;
+    }
+
+    std::string program_log(GLuint program)
+    {
+        GLint length = 0;
+        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+        std::string log(static_cast<size_t>(std::max(length, 1)), '\0');
+        glGetProgramInfoLog(program, static_cast<GLsizei>(log.size()), &length, log.data());
+        log.resize(static_cast<size_t>(length));
+        return log;
+    }
+
+    GLuint compile_shader(GLenum stage, const std::string& source, const std::string& file)
+    {
+        const GLuint shader = glCreateShader(stage);
+        const char* text = source.c_str();
+        glShaderSource(shader, 1, &text, nullptr);
+        glCompileShader(shader);
+        GLint success = GL_FALSE;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+        if (!success)
+        {
+            std::cout << "Failed to compile " << file << ":\n" << shader_log(shader) << std::endl;
+            glDeleteShader(shader);
+            return 0;
+        }
+        return shader;
+    }
+
+    std::filesystem::path cache_file(const std::filesystem::path& cache_dir, uint64_t key)
+    {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+        return cache_dir / name;
+    }
+
+    GLuint load_binary(const std::filesystem::path& path, uint64_t key)
+    {
+        std::ifstream in(path, std::ios::binary);
+        uint32_t magic = 0;
+        uint32_t version = 0;
+        uint64_t stored_key = 0;
+        GLenum format = 0;
+        uint32_t length = 0;
+        if (!in || !read_pod(in, magic) || !read_pod(in, version) || !read_pod(in, stored_key) || !read_pod(in, format) || !read_pod(in, length) ||
+            magic != cache_magic || version != cache_version || stored_key != key)
+        {
+            return 0;
+        }
+        std::vector<char> binary(length);
+        if (!in.read(binary.data(), length))
+        {
+            return 0;
+        }
+        // The driver may still reject a binary it wrote, e.g. after an update that kept the version string.
+        const GLuint program = glCreateProgram();
+        glProgramBinary(program, format, binary.data(), static_cast<GLsizei>(length));
+        GLint success = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (!success)
+        {
+            glDeleteProgram(program);
+            return 0;
+        }
+        return program;
+    }
+
+    void save_binary(const std::filesystem::path& path, uint64_t key, GLuint program)
+    {
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0)
+        {
+            return; // the driver doesn't support program binaries
+        }
+        std::vector<char> binary(static_cast<size_t>(length));
+        GLenum format = 0;
+        glGetProgramBinary(program, length, nullptr, &format, binary.data());
+
+        std::error_code error;
+        std::filesystem::create_directories(path.parent_path(), error);
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if (!out)
+        {
+            std::cout << "Failed to write shader cache " << path << std::endl;
+            return;
+        }
+        write_pod(out, cache_magic);
+        write_pod(out, cache_version);
+        write_pod(out, key);
+        write_pod(out, format);
+        write_pod(out, static_cast<uint32_t>(length));
+        out.write(binary.data(), length);
+    }
+}
+
+shader_manager::shader_manager(const std::filesystem::path& shader_dir, const std::filesystem::path& cache_dir, bool hot_reload)
+    : shader_dir_(shader_dir), cache_dir_(cache_dir), hot_reload_(hot_reload)
+{
+    // Binaries are only valid for the driver that produced them.
+    driver_hash_ = fnv1a_seed;
+    for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION })
+    {
+        const auto* text = reinterpret_cast<const char*>(glGetString(name));
+        driver_hash_ = fnv1a64(std::string_view(text ? text : ""), driver_hash_);
+    }
+    if (hot_reload_)
+    {
+        find_sources();
+        next_poll_ = std::chrono::steady_clock::now() + poll_interval;
+    }
+}
+
+shader_manager::~shader_manager()
+{
+    for (const shader_program& entry : programs_)
+    {
+        glDeleteProgram(entry.program);
+    }
+}
+
+program_handle shader_manager::load(const std::string& vertex_file, const std::string& fragment_file)
+{
+    ZoneScoped;
+    shader_program entry;
+    entry.vertex_file = vertex_file;
+    entry.fragment_file = fragment_file;
+    entry.program = build(entry, entry.key);
+    if (!entry.program)
+    {
+        throw std::runtime_error("Failed to build shader program " + vertex_file + " + " + fragment_file);
+    }
+    cache_uniforms(entry);
+    programs_.push_back(std::move(entry));
+    return static_cast<program_handle>(programs_.size() - 1);
+}
+
+GLuint shader_manager::build(shader_program& entry, uint64_t& key)
+{
+    std::string vertex;
+    std::string fragment;
+    std::string error;
+    if (!preprocess(shader_dir_ / entry.vertex_file, vertex, error) || !preprocess(shader_dir_ / entry.fragment_file, fragment, error))
+    {
+        std::cout << error << std::endl;
+        return 0;
+    }
+    key = fnv1a64(fragment, fnv1a64(vertex, driver_hash_));
+    if (key == entry.key && entry.program)
+    {
+        return entry.program; // nothing that reaches the compiler changed
+    }
+
+    const std::filesystem::path binary_path = cache_file(cache_dir_, key);
+    if (const GLuint cached = load_binary(binary_path, key))
+    {
+        return cached;
+    }
+
+    ZoneScopedN("compile shaders");
+    const GLuint vertex_shader = compile_shader(GL_VERTEX_SHADER, vertex, entry.vertex_file);
+    const GLuint fragment_shader = compile_shader(GL_FRAGMENT_SHADER, fragment, entry.fragment_file);
+    if (!vertex_shader || !fragment_shader)
+    {
+        glDeleteShader(vertex_shader);
+        glDeleteShader(fragment_shader);
+        return 0;
+    }
+    const GLuint program = glCreateProgram();
+    glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glAttachShader(program, vertex_shader);
+    glAttachShader(program, fragment_shader);
+    glLinkProgram(program);
+    glDeleteShader(vertex_shader);
+    glDeleteShader(fragment_shader);
+
+    GLint success = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        std::cout << "Failed to link " << entry.vertex_file << " + " << entry.fragment_file << ":\n" << program_log(program) << std::endl;
+        glDeleteProgram(program);
+        return 0;
+    }
+    save_binary(binary_path, key, program);
+    return program;
+}
+
+void shader_manager::cache_uniforms(shader_program& entry)
+{
+    entry.uniforms.clear();
+    GLint count = 0;
+    glGetProgramInterfaceiv(entry.program, GL_UNIFORM, GL_ACTIVE_RESOURCES, &count);
+    for (GLint i = 0; i < count; i++)
+    {
+        char name[256];
+        glGetProgramResourceName(entry.program, GL_UNIFORM, static_cast<GLuint>(i), sizeof(name), nullptr, name);
+        // Members of uniform blocks have no location.
+        const GLint location = glGetProgramResourceLocation(entry.program, GL_UNIFORM, name);
+        if (location >= 0)
+        {
+            entry.uniforms.emplace_back(name, location);
+        }
+    }
+    std::sort(entry.uniforms.begin(), entry.uniforms.end());
+}
+
+GLint shader_manager::uniform(program_handle handle, std::string_view name) const
+{
+    const auto& uniforms = programs_[handle].uniforms;
+    const auto it = std::lower_bound(uniforms.begin(), uniforms.end(), name, [](const auto& entry, std::string_view key) { return entry.first < key; });
+    return it != uniforms.end() && it->first == name ? it->second : -1;
+}
+
+void shader_manager::find_sources()
+{
+    // file_clock's epoch isn't 1970 everywhere, so real timestamps can be negative.
+    newest_source_ = std::filesystem::file_time_type::min();
+    sources_.clear();
+    std::error_code error;
+    for (auto it = std::filesystem::recursive_directory_iterator(shader_dir_, error); !error && it != std::filesystem::recursive_directory_iterator(); it.increment(error))
+    {
+        if (it->is_regular_file(error))
+        {
+            sources_.push_back(it->path());
+            newest_source_ = std::max(newest_source_, it->last_write_time(error));
+        }
+    }
+}
+
+bool shader_manager::sources_changed() const
+{
+    std::error_code error;
+    for (const std::filesystem::path& source : sources_)
+    {
+        const auto written = std::filesystem::last_write_time(source, error);
+        if (error || written > newest_source_)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool shader_manager::reload_changed()
+{
+    if (!hot_reload_)
+    {
+        return false;
+    }
+    const auto now = std::chrono::steady_clock::now();
+    if (now < next_poll_)
+    {
+        return false;
+    }
+    next_poll_ = now + poll_interval;
+    if (!sources_changed())
+    {
+        return false;
+    }
+    ZoneScopedN("reload shaders");
+    // Files may have been added or removed too, e.g. a new include.
+    find_sources();
+
+    bool reloaded = false;
+    for (shader_program& entry : programs_)
+    {
+        uint64_t key = 0;
+        const GLuint program = build(entry, key);
+        if (!program || program == entry.program)
+        {
+            continue;
+        }
+        glDeleteProgram(entry.program);
+        entry.program = program;
+        entry.key = key;
+        cache_uniforms(entry);
+        std::cout << "Reloaded " << entry.vertex_file << " + " << entry.fragment_file << std::endl;
+        reloaded = true;
+    }
+    return reloaded;
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <glad/gl.h>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+using program_handle = uint32_t;
+
+// Loads GLSL programs from disk. Sources go through stb_include, so a shader can #include "file"
+// relative to its own directory. Linked programs are cached with glGetProgramBinary, keyed by the
+// preprocessed sources and the driver, so a warm start compiles nothing. Uniform locations are
+// looked up once per link.
+class shader_manager
+{
+public:
+    // Sources changed on disk are picked up by reload_changed() at most this often.
+    static constexpr std::chrono::milliseconds poll_interval{ 500 };
+
+    // Without hot_reload the sources are never watched and reload_changed() does nothing.
+    shader_manager(const std::filesystem::path& shader_dir, const std::filesystem::path& cache_dir, bool hot_reload = false);
+    ~shader_manager();
+
+    shader_manager(const shader_manager&) = delete;
+    shader_manager& operator=(const shader_manager&) = delete;
+
+    // File names are relative to the shader directory. Throws if the program can't be built.
+    program_handle load(const std::string& vertex_file, const std::string& fragment_file);
+
+    GLuint program(program_handle handle) const { return programs_[handle].program; }
+    // -1 if the program has no active uniform of that name, like glGetUniformLocation().
+    GLint uniform(program_handle handle, std::string_view name) const;
+
+    // Rebuilds programs whose sources changed, including through an #include. A program that fails
+    // to build keeps running its previous version. Returns true if anything was replaced.
+    bool reload_changed();
+    bool hot_reload() const { return hot_reload_; }
+
+private:
+    struct shader_program
+    {
+        std::string vertex_file;
+        std::string fragment_file;
+        GLuint program = 0;
+        uint64_t key = 0; // hash of the preprocessed sources and the driver
+        std::vector<std::pair<std::string, GLint>> uniforms; // sorted by name
+    };
+
+    // Returns 0 after printing the reason if the sources can't be read, compiled or linked.
+    GLuint build(shader_program& entry, uint64_t& key);
+    void cache_uniforms(shader_program& entry);
+    // Lists every file under the shader directory and remembers the newest write time among them.
+    void find_sources();
+    // True if a listed source was written after the last find_sources() or can't be read anymore.
+    // Only stats the listed paths, so polling doesn't allocate.
+    bool sources_changed() const;
+
+    std::filesystem::path shader_dir_;
+    std::filesystem::path cache_dir_;
+    uint64_t driver_hash_ = 0;
+    std::vector<shader_program> programs_;
+    std::vector<std::filesystem::path> sources_; // includes too, so editing one rebuilds its users
+    std::filesystem::file_time_type newest_source_;
+    std::chrono::steady_clock::time_point next_poll_;
+    bool hot_reload_ = false;
+};
@@ -0,0 +1,111 @@
+#include "simulation.h"
+#include <tracy/Tracy.hpp>
+#include <cmath>
+
+simulation::simulation(job_system& jobs, frame_memory& memory, const aabb& bounds)
+    : jobs_(jobs), memory_(memory), bounds_(bounds), broadphase_(bounds, broadphase_cell_size)
+{
+    set_movement_simd(detect_simd_level());
+}
+
+void simulation::set_bounds(const aabb& bounds)
+{
+    bounds_ = bounds;
+    broadphase_.reset(bounds, broadphase_cell_size);
+}
+
+void simulation::set_steering(glm::vec2 target, float acceleration, float max_speed)
+{
+    steering_target_ = target;
+    steering_acceleration_ = acceleration;
+    max_speed_ = max_speed;
+}
+
+void simulation::set_movement_simd(simd_level level)
+{
+    simd_ = level;
+    move_ = select_movement_kernel(level);
+}
+
+float simulation::advance(entity_registry& registry, double frame_seconds)
+{
+    ZoneScoped;
+    accumulator_ += frame_seconds;
+    int steps = 0;
+    while (accumulator_ >= tick_seconds && steps < max_ticks_per_frame)
+    {
+        tick(registry, static_cast<float>(tick_seconds));
+        accumulator_ -= tick_seconds;
+        steps++;
+    }
+    if (steps == max_ticks_per_frame)
+    {
+        accumulator_ = std::fmod(accumulator_, tick_seconds); // drop the backlog instead of spiralling
+    }
+    TracyPlot("simulation ticks per frame", static_cast<int64_t>(steps));
+    return static_cast<float>(accumulator_ / tick_seconds);
+}
+
+void simulation::tick(entity_registry& registry, float dt)
+{
+    ZoneScopedN("simulation tick");
+    ticks_++;
+
+    // Remember where everything was so rendering can interpolate towards the new state.
+    arena_vector<snapshot_chunk> snapshot_chunks{ arena_allocator<snapshot_chunk>(memory_.current()) };
+    registry.each_chunk<position, previous_position>([&snapshot_chunks](uint32_t count, const entity_handle*, position* p, previous_position* prev)
+    {
+        snapshot_chunks.push_back({ count, p, prev });
+    });
+    jobs_.parallel_for(snapshot_chunks.size(), 1, [&snapshot_chunks](size_t begin, size_t end)
+    {
+        for (size_t c = begin; c < end; c++)
+        {
+            const snapshot_chunk& chunk = snapshot_chunks[c];
+            for (uint32_t i = 0; i < chunk.count; i++)
+            {
+                chunk.previous[i].value = chunk.positions[i].value;
+            }
+        }
+    });
+
+    // Steer, move and bounce off the world edges. Each chunk is an independent batch of entities
+    // whose columns the movement kernel updates in place.
+    arena_vector<movement_batch> movement_batches{ arena_allocator<movement_batch>(memory_.current()) };
+    registry.each_chunk<position, velocity, scale>([&movement_batches](uint32_t count, const entity_handle*, position* p, velocity* v, scale* s)
+    {
+        movement_batches.push_back({ count, &p->value.x, &v->value.x, &s->value.x });
+    });
+    movement_params params;
+    params.dt = dt;
+    params.bounds = bounds_;
+    params.target = steering_target_;
+    params.acceleration = steering_acceleration_;
+    params.max_speed = max_speed_;
+    jobs_.parallel_for(movement_batches.size(), 1, [&movement_batches, &params, move = move_](size_t begin, size_t end)
+    {
+        for (size_t c = begin; c < end; c++)
+        {
+            move(movement_batches[c], params);
+        }
+    });
+
+    rebuild_broadphase(registry);
+}
+
+void simulation::rebuild_broadphase(entity_registry& registry)
+{
+    ZoneScoped;
+    boxes_.clear();
+    box_owners_.clear();
+    registry.each_chunk<position, scale>([this](uint32_t count, const entity_handle* handles, position* p, scale* s)
+    {
+        for (uint32_t i = 0; i < count; i++)
+        {
+            const glm::vec2 half = s[i].value * 0.5f;
+            boxes_.push_back({ p[i].value - half, p[i].value + half });
+            box_owners_.push_back(handles[i]);
+        }
+    });
+    broadphase_.rebuild(boxes_);
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <limits>
+#include <vector>
+#include "entity.h"
+#include "entity_registry.h"
+#include "job_system.h"
+#include "memory.h"
+#include "movement_kernels.h"
+#include "spatial_hash.h"
+
+// Advances the game at a fixed rate independent of the display refresh rate. Rendering interpolates
+// between the last two ticks using the alpha returned by advance().
+class simulation
+{
+public:
+    static constexpr double tick_rate = 120.0;
+    static constexpr double tick_seconds = 1.0 / tick_rate;
+    // Never simulate more than this many ticks per frame, so a long stall doesn't snowball.
+    static constexpr int max_ticks_per_frame = 8;
+
+    // Broadphase cells are about the size of a slime.
+    static constexpr float broadphase_cell_size = 64.0f;
+
+    // Per-tick scratch lists come from `memory`'s current frame arena.
+    simulation(job_system& jobs, frame_memory& memory, const aabb& bounds);
+
+    // Runs as many ticks as fit in the elapsed time and returns the interpolation factor in [0, 1).
+    float advance(entity_registry& registry, double frame_seconds);
+    void tick(entity_registry& registry, float dt);
+
+    uint64_t ticks() const { return ticks_; }
+    const aabb& bounds() const { return bounds_; }
+    void set_bounds(const aabb& bounds);
+
+    // Every moving entity accelerates toward `target` and is slowed down to at most `max_speed`.
+    // An acceleration of 0 (the default) turns steering off.
+    void set_steering(glm::vec2 target, float acceleration, float max_speed);
+
+    // Movement runs the best kernel the CPU supports unless told otherwise, e.g. to compare them.
+    simd_level movement_simd() const { return simd_; }
+    void set_movement_simd(simd_level level);
+
+    // Entity boxes as of the end of the last tick. Ids index broadphase_owner().
+    const spatial_hash& broadphase() const { return broadphase_; }
+    entity_handle broadphase_owner(uint32_t id) const { return box_owners_[id]; }
+
+private:
+    struct snapshot_chunk
+    {
+        uint32_t count;
+        const position* positions;
+        previous_position* previous;
+    };
+
+    void rebuild_broadphase(entity_registry& registry);
+
+    job_system& jobs_;
+    frame_memory& memory_;
+    aabb bounds_;
+    glm::vec2 steering_target_ = {};
+    float steering_acceleration_ = 0.0f;
+    float max_speed_ = std::numeric_limits<float>::infinity();
+    simd_level simd_ = simd_level::scalar;
+    movement_kernel move_ = move_entities_scalar;
+    double accumulator_ = 0.0;
+    uint64_t ticks_ = 0;
+    // Reused every tick so rebuilding the broadphase doesn't allocate in steady state.
+    std::vector<aabb> boxes_;
+    std::vector<entity_handle> box_owners_;
+    spatial_hash broadphase_;
+};
@@ -0,0 +1,121 @@
+#include "spatial_hash.h"
+#include <tracy/Tracy.hpp>
+#include <cmath>
+
+spatial_hash::spatial_hash(const aabb& world, float cell_size)
+{
+    reset(world, cell_size);
+}
+
+void spatial_hash::reset(const aabb& world, float cell_size)
+{
+    world_ = world;
+    inv_cell_size_ = 1.0f / cell_size;
+    const glm::vec2 extent = world.max - world.min;
+    columns_ = std::max(1u, static_cast<uint32_t>(std::ceil(extent.x * inv_cell_size_)));
+    rows_ = std::max(1u, static_cast<uint32_t>(std::ceil(extent.y * inv_cell_size_)));
+    cell_start_.assign(cell_count() + 1, 0);
+    cursor_.resize(cell_count());
+    entries_.clear();
+    boxes_.clear();
+}
+
+// Anything outside the world lands in the border cells, so it is still found, just less efficiently.
+uint32_t spatial_hash::column_of(float x) const
+{
+    const float column = std::floor((x - world_.min.x) * inv_cell_size_);
+    return static_cast<uint32_t>(std::clamp(column, 0.0f, static_cast<float>(columns_ - 1)));
+}
+
+uint32_t spatial_hash::row_of(float y) const
+{
+    const float row = std::floor((y - world_.min.y) * inv_cell_size_);
+    return static_cast<uint32_t>(std::clamp(row, 0.0f, static_cast<float>(rows_ - 1)));
+}
+
+void spatial_hash::rebuild(std::span<const aabb> boxes)
+{
+    ZoneScopedN("broadphase rebuild");
+    boxes_.assign(boxes.begin(), boxes.end());
+
+    // Count how many boxes touch each cell...
+    std::fill(cell_start_.begin(), cell_start_.end(), 0u);
+    size_t total = 0;
+    for (const aabb& box : boxes_)
+    {
+        const uint32_t x0 = column_of(box.min.x), x1 = column_of(box.max.x);
+        const uint32_t y0 = row_of(box.min.y), y1 = row_of(box.max.y);
+        for (uint32_t y = y0; y <= y1; y++)
+        {
+            for (uint32_t x = x0; x <= x1; x++)
+            {
+                cell_start_[y * columns_ + x + 1]++;
+            }
+        }
+        total += static_cast<size_t>(x1 - x0 + 1) * (y1 - y0 + 1);
+    }
+    // ...turn the counts into start offsets...
+    for (uint32_t cell = 0; cell < cell_count(); cell++)
+    {
+        cell_start_[cell + 1] += cell_start_[cell];
+    }
+    // ...and scatter the ids into place.
+    entries_.resize(total);
+    std::copy(cell_start_.begin(), cell_start_.end() - 1, cursor_.begin());
+    for (uint32_t id = 0; id < boxes_.size(); id++)
+    {
+        const aabb& box = boxes_[id];
+        const uint32_t x0 = column_of(box.min.x), x1 = column_of(box.max.x);
+        const uint32_t y0 = row_of(box.min.y), y1 = row_of(box.max.y);
+        for (uint32_t y = y0; y <= y1; y++)
+        {
+            for (uint32_t x = x0; x <= x1; x++)
+            {
+                entries_[cursor_[y * columns_ + x]++] = id;
+            }
+        }
+    }
+}
+
+template<typename F>
+void spatial_hash::visit_rect(const aabb& rect, F&& f) const
+{
+    const uint32_t x0 = column_of(rect.min.x), x1 = column_of(rect.max.x);
+    const uint32_t y0 = row_of(rect.min.y), y1 = row_of(rect.max.y);
+    for (uint32_t y = y0; y <= y1; y++)
+    {
+        for (uint32_t x = x0; x <= x1; x++)
+        {
+            const uint32_t cell = y * columns_ + x;
+            for (uint32_t i = cell_start_[cell]; i < cell_start_[cell + 1]; i++)
+            {
+                const uint32_t id = entries_[i];
+                const aabb& box = boxes_[id];
+                if (overlaps(box, rect) && reference_cell(glm::max(box.min, rect.min)) == cell)
+                {
+                    f(id, box);
+                }
+            }
+        }
+    }
+}
+
+void spatial_hash::query_rect(const aabb& rect, std::vector<uint32_t>& out) const
+{
+    visit_rect(rect, [&out](uint32_t id, const aabb&) { out.push_back(id); });
+}
+
+void spatial_hash::query_radius(glm::vec2 center, float radius, std::vector<uint32_t>& out) const
+{
+    const aabb bounds = { center - glm::vec2(radius), center + glm::vec2(radius) };
+    const float radius_squared = radius * radius;
+    visit_rect(bounds, [&](uint32_t id, const aabb& box)
+    {
+        const glm::vec2 closest = glm::clamp(center, box.min, box.max);
+        const glm::vec2 delta = closest - center;
+        if (glm::dot(delta, delta) <= radius_squared)
+        {
+            out.push_back(id);
+        }
+    });
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+struct aabb
+{
+    glm::vec2 min;
+    glm::vec2 max;
+};
+
+inline bool overlaps(const aabb& a, const aabb& b)
+{
+    return a.min.x <= b.max.x && b.min.x <= a.max.x && a.min.y <= b.max.y && b.min.y <= a.max.y;
+}
+
+// Two overlapping boxes, as indices into the array passed to spatial_hash::rebuild().
+struct box_pair
+{
+    uint32_t a;
+    uint32_t b;
+};
+
+// Uniform-grid broadphase over a bounded world. rebuild() bins every box into the cells it touches
+// with a counting sort, so each cell's contents are contiguous. All storage is reused between
+// rebuilds: once the buffers have grown to the working set, rebuilding and querying don't allocate.
+//
+// Boxes spanning several cells are reported once: a pair (or a query hit) is only emitted from the
+// cell containing the minimum corner of the overlap region.
+class spatial_hash
+{
+public:
+    static constexpr size_t pair_batch_size = 1024;
+
+    spatial_hash(const aabb& world, float cell_size);
+
+    // Rebinning with a different world or cell size reuses the existing buffers.
+    void reset(const aabb& world, float cell_size);
+    void rebuild(std::span<const aabb> boxes);
+
+    size_t size() const { return boxes_.size(); }
+    const aabb& box(uint32_t id) const { return boxes_[id]; }
+
+    // Calls f(std::span<const box_pair>) with batches of at most pair_batch_size overlapping pairs.
+    template<typename F>
+    void for_each_pair_batch(F&& f) const
+    {
+        box_pair batch[pair_batch_size];
+        size_t count = 0;
+        for (uint32_t cell = 0; cell < cell_count(); cell++)
+        {
+            const uint32_t begin = cell_start_[cell];
+            const uint32_t end = cell_start_[cell + 1];
+            for (uint32_t i = begin; i < end; i++)
+            {
+                const uint32_t a = entries_[i];
+                for (uint32_t j = i + 1; j < end; j++)
+                {
+                    const uint32_t b = entries_[j];
+                    if (!overlaps(boxes_[a], boxes_[b]) || reference_cell(glm::max(boxes_[a].min, boxes_[b].min)) != cell)
+                    {
+                        continue;
+                    }
+                    batch[count++] = { std::min(a, b), std::max(a, b) };
+                    if (count == pair_batch_size)
+                    {
+                        f(std::span<const box_pair>(batch, count));
+                        count = 0;
+                    }
+                }
+            }
+        }
+        if (count > 0)
+        {
+            f(std::span<const box_pair>(batch, count));
+        }
+    }
+
+    // Appends the ids of all boxes overlapping `rect` to `out`.
+    void query_rect(const aabb& rect, std::vector<uint32_t>& out) const;
+    // Appends the ids of all boxes within `radius` of `center` to `out`.
+    void query_radius(glm::vec2 center, float radius, std::vector<uint32_t>& out) const;
+
+private:
+    uint32_t cell_count() const { return columns_ * rows_; }
+    uint32_t column_of(float x) const;
+    uint32_t row_of(float y) const;
+    uint32_t reference_cell(glm::vec2 point) const { return row_of(point.y) * columns_ + column_of(point.x); }
+
+    // Visits every box in the cells overlapped by `rect`, once per box.
+    template<typename F>
+    void visit_rect(const aabb& rect, F&& f) const;
+
+    aabb world_;
+    float inv_cell_size_ = 0.0f;
+    uint32_t columns_ = 0;
+    uint32_t rows_ = 0;
+    std::vector<aabb> boxes_;
+    std::vector<uint32_t> cell_start_; // prefix sums, cell_count() + 1 entries
+    std::vector<uint32_t> cursor_;     // scratch for the counting sort
+    std::vector<uint32_t> entries_;    // box ids grouped by cell
+};
@@ -0,0 +1,223 @@
+#include "sprite_batch.h"
+#include <tracy/Tracy.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+namespace
+{
+    // Vertex buffer binding index used for the per-instance stream. The quad uses binding 0.
+    constexpr GLuint instance_binding = 3;
+    constexpr GLuint position_attribute = 3;
+    constexpr GLuint scale_attribute = 4;
+    constexpr GLuint uv_attribute = 5;
+    constexpr GLuint layer_attribute = 6;
+    constexpr GLuint clip_attribute = 7;
+    constexpr GLuint clip_start_attribute = 8;
+    constexpr GLuint clip_speed_attribute = 9;
+
+    void wait_for_fence(GLsync& fence)
+    {
+        if (!fence)
+        {
+            return;
+        }
+        ZoneScopedN("sprite_batch wait");
+        GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        while (result == GL_TIMEOUT_EXPIRED)
+        {
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1'000'000);
+        }
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+}
+
+void bind_sprite_instances(GLuint vao, GLuint buffer)
+{
+    glVertexArrayVertexBuffer(vao, instance_binding, buffer, 0, sizeof(sprite_instance));
+    glVertexArrayBindingDivisor(vao, instance_binding, 1);
+
+    glEnableVertexArrayAttrib(vao, position_attribute);
+    glVertexArrayAttribFormat(vao, position_attribute, 2, GL_FLOAT, GL_FALSE, offsetof(sprite_instance, position));
+    glVertexArrayAttribBinding(vao, position_attribute, instance_binding);
+
+    glEnableVertexArrayAttrib(vao, scale_attribute);
+    glVertexArrayAttribFormat(vao, scale_attribute, 2, GL_FLOAT, GL_FALSE, offsetof(sprite_instance, scale));
+    glVertexArrayAttribBinding(vao, scale_attribute, instance_binding);
+
+    glEnableVertexArrayAttrib(vao, uv_attribute);
+    glVertexArrayAttribFormat(vao, uv_attribute, 4, GL_FLOAT, GL_FALSE, offsetof(sprite_instance, uv));
+    glVertexArrayAttribBinding(vao, uv_attribute, instance_binding);
+
+    glEnableVertexArrayAttrib(vao, layer_attribute);
+    glVertexArrayAttribIFormat(vao, layer_attribute, 1, GL_UNSIGNED_INT, offsetof(sprite_instance, layer));
+    glVertexArrayAttribBinding(vao, layer_attribute, instance_binding);
+
+    glEnableVertexArrayAttrib(vao, clip_attribute);
+    glVertexArrayAttribIFormat(vao, clip_attribute, 1, GL_UNSIGNED_INT, offsetof(sprite_instance, clip));
+    glVertexArrayAttribBinding(vao, clip_attribute, instance_binding);
+
+    glEnableVertexArrayAttrib(vao, clip_start_attribute);
+    glVertexArrayAttribFormat(vao, clip_start_attribute, 1, GL_FLOAT, GL_FALSE, offsetof(sprite_instance, clip_start));
+    glVertexArrayAttribBinding(vao, clip_start_attribute, instance_binding);
+
+    glEnableVertexArrayAttrib(vao, clip_speed_attribute);
+    glVertexArrayAttribFormat(vao, clip_speed_attribute, 1, GL_FLOAT, GL_FALSE, offsetof(sprite_instance, clip_speed));
+    glVertexArrayAttribBinding(vao, clip_speed_attribute, instance_binding);
+}
+
+sprite_batch::sprite_batch(GLuint vao, uint32_t max_instances)
+    : vao_(vao), max_instances_(max_instances)
+{
+    const GLsizeiptr size = static_cast<GLsizeiptr>(sizeof(sprite_instance)) * max_instances_ * frames_in_flight;
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glCreateBuffers(1, &buffer_);
+    glNamedBufferStorage(buffer_, size, nullptr, flags);
+    mapped_ = static_cast<sprite_instance*>(glMapNamedBufferRange(buffer_, 0, size, flags));
+    if (!mapped_)
+    {
+        throw std::runtime_error("Failed to map sprite instance buffer");
+    }
+
+    // The whole ring is bound once; each draw selects its slice through baseinstance.
+    bind_sprite_instances(vao_, buffer_);
+}
+
+sprite_batch::~sprite_batch()
+{
+    for (GLsync& fence : fences_)
+    {
+        if (fence)
+        {
+            glDeleteSync(fence);
+        }
+    }
+    glUnmapNamedBuffer(buffer_);
+    glDeleteBuffers(1, &buffer_);
+}
+
+void sprite_batch::begin()
+{
+    if (region_submitted_)
+    {
+        fences_[region_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        region_ = (region_ + 1) % frames_in_flight;
+        region_submitted_ = false;
+    }
+    // allocate() writes into the region right away, so it has to be free before anything is queued.
+    wait_for_fence(fences_[region_]);
+    for (texture_group& group : groups_)
+    {
+        group.instances.clear();
+    }
+    runs_.clear();
+    queued_ = 0;
+    allocated_ = 0;
+}
+
+bool sprite_batch::reserve(uint32_t count)
+{
+    if (max_instances_ - queued_ >= count)
+    {
+        return true;
+    }
+    if (!overflow_reported_)
+    {
+        std::cout << "sprite_batch: more than " << max_instances_ << " sprites queued, extra sprites are dropped" << std::endl;
+        overflow_reported_ = true;
+    }
+    return false;
+}
+
+sprite_batch::texture_group& sprite_batch::group_for(GLuint texture)
+{
+    // Consecutive sprites almost always share a texture, so check the previous group first.
+    if (last_group_ < groups_.size() && groups_[last_group_].texture == texture)
+    {
+        return groups_[last_group_];
+    }
+    for (size_t i = 0; i < groups_.size(); i++)
+    {
+        if (groups_[i].texture == texture)
+        {
+            last_group_ = i;
+            return groups_[i];
+        }
+    }
+    last_group_ = groups_.size();
+    return groups_.emplace_back(texture_group{ texture, {} });
+}
+
+void sprite_batch::draw(GLuint texture, const atlas_region& region, glm::vec2 position, glm::vec2 scale, float clip_start, float clip_speed)
+{
+    if (!reserve(1))
+    {
+        return;
+    }
+    group_for(texture).instances.push_back({ position, scale, region.uv, region.layer, region.clip, clip_start, clip_speed });
+    queued_++;
+}
+
+std::span<sprite_instance> sprite_batch::allocate(GLuint texture, uint32_t count)
+{
+    if (!reserve(count))
+    {
+        count = max_instances_ - queued_;
+    }
+    if (count == 0)
+    {
+        return {};
+    }
+    if (!runs_.empty() && runs_.back().texture == texture)
+    {
+        runs_.back().count += count;
+    }
+    else
+    {
+        runs_.push_back({ texture, allocated_, count });
+    }
+    sprite_instance* instances = mapped_ + region_ * max_instances_ + allocated_;
+    allocated_ += count;
+    queued_ += count;
+    return { instances, count };
+}
+
+const sprite_batch_stats& sprite_batch::flush(render_queue& queue, GLuint program, render_layer layer)
+{
+    ZoneScopedN("sprite_batch flush");
+    const auto start = std::chrono::steady_clock::now();
+
+    stats_.draw_items = 0;
+    stats_.instances = queued_;
+    stats_.bytes_uploaded = static_cast<uint64_t>(queued_) * sizeof(sprite_instance);
+
+    const uint32_t region_base = region_ * max_instances_;
+    for (const direct_run& run : runs_)
+    {
+        queue.push(layer, 0, { program, vao_, run.texture, 6, 0, run.count, region_base + run.first });
+        stats_.draw_items++;
+    }
+    uint32_t offset = allocated_;
+    for (const texture_group& group : groups_)
+    {
+        if (group.instances.empty())
+        {
+            continue;
+        }
+        const auto count = static_cast<uint32_t>(group.instances.size());
+        std::memcpy(mapped_ + region_base + offset, group.instances.data(), count * sizeof(sprite_instance));
+        queue.push(layer, 0, { program, vao_, group.texture, 6, 0, count, region_base + offset });
+        offset += count;
+        stats_.draw_items++;
+    }
+    region_submitted_ = stats_.draw_items > 0;
+
+    stats_.submit_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    TracyPlot("sprite draw items", static_cast<int64_t>(stats_.draw_items));
+    TracyPlot("sprite instances", static_cast<int64_t>(stats_.instances));
+    TracyPlot("sprite submit ms", stats_.submit_ms);
+    return stats_;
+}
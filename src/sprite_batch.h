@@ -0,0 +1,101 @@
+#pragma once
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "render_queue.h"
+#include "texture_atlas.h"
+
+// Per-instance data streamed to the GPU. Must match the instanced attributes of the sprite vertex shader.
+struct sprite_instance
+{
+    glm::vec2 position;
+    glm::vec2 scale;
+    glm::vec4 uv;
+    uint32_t layer;
+    // Animated sprites: the shader replaces uv and layer with the clip's current frame.
+    clip_handle clip;
+    float clip_start; // value of the shader's time uniform when the clip was at its first frame
+    float clip_speed; // playback rate, 1 = as authored
+};
+
+// Points the instanced attributes (3-9) of `vao` at `buffer`, one sprite_instance per instance.
+void bind_sprite_instances(GLuint vao, GLuint buffer);
+
+struct sprite_batch_stats
+{
+    uint32_t draw_items; // pushed to the render queue, one per texture run
+    uint32_t instances;
+    uint64_t bytes_uploaded;
+    double submit_ms; // CPU time spent in flush()
+};
+
+// Collects sprites for a frame and queues every texture group as a single instanced draw.
+// Instances are written into a persistently mapped buffer split into three regions; each region is
+// guarded by a fence so the CPU never overwrites data the GPU is still reading. The draws only
+// reach GL when the render queue executes, so a region is fenced by the next begin().
+//
+// draw() queues one sprite at a time and copies them into the buffer in flush(). allocate() hands
+// out instances in the mapped buffer itself, so whole batches can be written straight to the GPU.
+class sprite_batch
+{
+public:
+    static constexpr uint32_t frames_in_flight = 3;
+    // Enough for the largest stress scene plus the rest of the world.
+    static constexpr uint32_t default_capacity = 1 << 17;
+
+    // vao must already describe the unit quad (see create_quad_vao()).
+    sprite_batch(GLuint vao, uint32_t max_instances);
+    ~sprite_batch();
+
+    sprite_batch(const sprite_batch&) = delete;
+    sprite_batch& operator=(const sprite_batch&) = delete;
+
+    // Fences last frame's region and waits until the GPU is done with this frame's one.
+    void begin();
+    void draw(GLuint texture, const atlas_region& region, glm::vec2 position, glm::vec2 scale, float clip_start = 0.0f, float clip_speed = 1.0f);
+    // Reserves `count` instances in the mapped buffer, all drawn with `texture`. Every instance must
+    // be written before flush(); writes go straight to GPU-visible memory, so write each one once
+    // and never read it back. Returns fewer instances (maybe none) when the batch is full. Allocated
+    // sprites are drawn before the ones queued with draw().
+    std::span<sprite_instance> allocate(GLuint texture, uint32_t count);
+    // Uploads everything queued since begin() and pushes its draws to `queue`, on `layer`.
+    const sprite_batch_stats& flush(render_queue& queue, GLuint program, render_layer layer = render_layer::sprites);
+
+    const sprite_batch_stats& stats() const { return stats_; }
+    uint32_t capacity() const { return max_instances_; }
+
+private:
+    struct texture_group
+    {
+        GLuint texture;
+        std::vector<sprite_instance> instances;
+    };
+
+    // Instances written through allocate(), in order, at the start of the current region.
+    struct direct_run
+    {
+        GLuint texture;
+        uint32_t first;
+        uint32_t count;
+    };
+
+    texture_group& group_for(GLuint texture);
+    bool reserve(uint32_t count);
+
+    GLuint vao_ = 0;
+    GLuint buffer_ = 0;
+    sprite_instance* mapped_ = nullptr;
+    uint32_t max_instances_ = 0;
+    uint32_t queued_ = 0;
+    uint32_t allocated_ = 0; // by allocate(); part of queued_
+    uint32_t region_ = 0;
+    bool region_submitted_ = false; // flush() queued draws reading the current region
+    GLsync fences_[frames_in_flight] = {};
+    std::vector<texture_group> groups_;
+    std::vector<direct_run> runs_;
+    size_t last_group_ = 0;
+    sprite_batch_stats stats_ = {};
+    bool overflow_reported_ = false;
+};
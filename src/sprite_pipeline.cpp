@@ -0,0 +1,54 @@
+#include "sprite_pipeline.h"
+
+namespace
+{
+    // Square corrdinates
+    const float vertices[] = {
+        // positions          // colors           // texture coords
+         0.5f,  0.5f, 0.0f,   1.0f, 0.0f, 0.0f,   1.0f, 1.0f,   // top right
+         0.5f, -0.5f, 0.0f,   0.0f, 1.0f, 0.0f,   1.0f, 0.0f,   // bottom right
+        -0.5f, -0.5f, 0.0f,   0.0f, 0.0f, 1.0f,   0.0f, 0.0f,   // bottom left
+        -0.5f,  0.5f, 0.0f,   1.0f, 1.0f, 0.0f,   0.0f, 1.0f    // top left
+    };
+    const unsigned int indices[] = {  // note that we start from 0!
+        0, 1, 3,   // first triangle
+        1, 2, 3,   // second triangle
+    };
+}
+
+sprite_pipeline create_sprite_pipeline(shader_manager& shaders)
+{
+    sprite_pipeline pipeline;
+    pipeline.program = shaders.load("sprite.vert", "sprite.frag");
+
+    glCreateBuffers(1, &pipeline.vbo);
+    glNamedBufferStorage(pipeline.vbo, sizeof(vertices), vertices, 0);
+    glCreateBuffers(1, &pipeline.ebo);
+    glNamedBufferStorage(pipeline.ebo, sizeof(indices), indices, 0);
+    pipeline.vao = create_quad_vao(pipeline);
+    return pipeline;
+}
+
+void destroy_sprite_pipeline(sprite_pipeline& pipeline)
+{
+    glDeleteVertexArrays(1, &pipeline.vao);
+    glDeleteBuffers(1, &pipeline.vbo);
+    glDeleteBuffers(1, &pipeline.ebo);
+    pipeline = {};
+}
+
+GLuint create_quad_vao(const sprite_pipeline& pipeline)
+{
+    // Attributes 0 (position) and 2 (texture coords) read vertex binding 0.
+    GLuint vao;
+    glCreateVertexArrays(1, &vao);
+    glVertexArrayVertexBuffer(vao, 0, pipeline.vbo, 0, 8 * sizeof(float));
+    glVertexArrayElementBuffer(vao, pipeline.ebo);
+    glEnableVertexArrayAttrib(vao, 0);
+    glVertexArrayAttribFormat(vao, 0, 3, GL_FLOAT, GL_FALSE, 0);
+    glVertexArrayAttribBinding(vao, 0, 0);
+    glEnableVertexArrayAttrib(vao, 2);
+    glVertexArrayAttribFormat(vao, 2, 2, GL_FLOAT, GL_FALSE, 6 * sizeof(float));
+    glVertexArrayAttribBinding(vao, 2, 0);
+    return vao;
+}
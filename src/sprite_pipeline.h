@@ -0,0 +1,21 @@
+#pragma once
+#include <glad/gl.h>
+#include "shader_manager.h"
+
+// The unit quad and the shader program every sprite is drawn with. Shared by the game and the
+// headless benchmark so both render exactly the same way.
+struct sprite_pipeline
+{
+    program_handle program = 0; // sprite.vert + sprite.frag, owned by the shader_manager
+    GLuint vao = 0; // unit quad: attribute 0 position, attribute 2 texture coords, EBO bound
+    GLuint vbo = 0;
+    GLuint ebo = 0;
+};
+
+// Requires a current GL context. Throws if the sprite program can't be built.
+sprite_pipeline create_sprite_pipeline(shader_manager& shaders);
+void destroy_sprite_pipeline(sprite_pipeline& pipeline);
+
+// Another VAO over the pipeline's unit quad, for renderers that bind their own instance buffer.
+// The caller owns it; it must not outlive the pipeline.
+GLuint create_quad_vao(const sprite_pipeline& pipeline);
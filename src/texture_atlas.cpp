@@ -0,0 +1,587 @@
+#include "texture_atlas.h"
+#include "binary_io.h"
+#include "hash.h"
+#include "asset_loader.h"
+#include <tracy/Tracy.hpp>
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <stdexcept>
+
+namespace
+{
+    constexpr uint32_t cache_magic = 0x534c5441; // "ATLS"
+    constexpr uint32_t cache_version = 3;
+
+    // Each sprite is surrounded by `padding` pixels of its own extruded border, and rects start on
+    // multiples of 2^(mip_levels - 1), so mip levels never blend neighbouring sprites together.
+    constexpr uint32_t padding = 4;
+    constexpr uint32_t mip_levels = 3;
+    constexpr uint32_t rect_alignment = 1 << (mip_levels - 1);
+    constexpr uint32_t min_page_size = 256;
+    constexpr uint32_t max_page_size = 4096;
+    // Pages only grow past max_page_size to fit a single huge image. These are the smallest
+    // GL_MAX_TEXTURE_SIZE and GL_MAX_ARRAY_TEXTURE_LAYERS GL 4.6 allows, and bound what a cache may claim.
+    constexpr uint32_t max_cached_page_size = 16384;
+    constexpr uint32_t max_cached_layers = 2048;
+
+    // Identity of a source image, used to decide whether the cache is still valid.
+    struct source_file
+    {
+        std::filesystem::path path;
+        std::string name;
+        uint64_t size;
+        int64_t mtime;
+    };
+
+    uint32_t align_up(uint32_t value, uint32_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    bool is_image(const std::filesystem::path& path)
+    {
+        std::string ext = path.extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return ext == ".png" || ext == ".gif" || ext == ".jpg" || ext == ".jpeg" || ext == ".bmp" || ext == ".tga";
+    }
+
+    std::vector<source_file> scan_sources(const std::filesystem::path& source_dir)
+    {
+        std::vector<source_file> sources;
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(source_dir))
+        {
+            if (!entry.is_regular_file() || !is_image(entry.path()))
+            {
+                continue;
+            }
+            sources.push_back({ entry.path(), entry.path().stem().string(), entry.file_size(),
+                static_cast<int64_t>(entry.last_write_time().time_since_epoch().count()) });
+        }
+        std::sort(sources.begin(), sources.end(), [](const source_file& a, const source_file& b) { return a.path < b.path; });
+        return sources;
+    }
+
+    uint64_t hash_file(const std::filesystem::path& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        std::vector<char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        return fnv1a64(bytes.data(), bytes.size());
+    }
+
+    // Skyline bottom-left bin packer for one square page.
+    class skyline_packer
+    {
+    public:
+        explicit skyline_packer(uint32_t size) : size_(size), skyline_{ { 0, 0, size } } {}
+
+        bool insert(uint32_t width, uint32_t height, uint32_t& out_x, uint32_t& out_y)
+        {
+            size_t best = skyline_.size();
+            uint32_t best_top = UINT32_MAX;
+            uint32_t best_y = 0;
+            for (size_t i = 0; i < skyline_.size(); i++)
+            {
+                uint32_t y = 0;
+                if (fits(i, width, height, y) && (y + height < best_top || (y + height == best_top && skyline_[i].x < skyline_[best].x)))
+                {
+                    best = i;
+                    best_top = y + height;
+                    best_y = y;
+                }
+            }
+            if (best == skyline_.size())
+            {
+                return false;
+            }
+            out_x = skyline_[best].x;
+            out_y = best_y;
+            add_segment(best, { out_x, best_y + height, width });
+            return true;
+        }
+
+    private:
+        struct segment
+        {
+            uint32_t x;
+            uint32_t y;
+            uint32_t width;
+        };
+
+        // A rect placed at segment i rests on the highest segment it spans.
+        bool fits(size_t i, uint32_t width, uint32_t height, uint32_t& y) const
+        {
+            if (skyline_[i].x + width > size_)
+            {
+                return false;
+            }
+            y = 0;
+            uint32_t remaining = width;
+            for (size_t j = i; remaining > 0; j++)
+            {
+                y = std::max(y, skyline_[j].y);
+                if (y + height > size_)
+                {
+                    return false;
+                }
+                remaining -= std::min(remaining, skyline_[j].width);
+            }
+            return true;
+        }
+
+        void add_segment(size_t index, segment added)
+        {
+            skyline_.insert(skyline_.begin() + static_cast<std::ptrdiff_t>(index), added);
+            // Shrink or remove the segments now covered by the new one.
+            for (size_t i = index + 1; i < skyline_.size();)
+            {
+                const uint32_t end = added.x + added.width;
+                if (skyline_[i].x >= end)
+                {
+                    break;
+                }
+                const uint32_t overlap = end - skyline_[i].x;
+                if (skyline_[i].width <= overlap)
+                {
+                    skyline_.erase(skyline_.begin() + static_cast<std::ptrdiff_t>(i));
+                    continue;
+                }
+                skyline_[i].x += overlap;
+                skyline_[i].width -= overlap;
+                break;
+            }
+            for (size_t i = 0; i + 1 < skyline_.size();)
+            {
+                if (skyline_[i].y == skyline_[i + 1].y)
+                {
+                    skyline_[i].width += skyline_[i + 1].width;
+                    skyline_.erase(skyline_.begin() + static_cast<std::ptrdiff_t>(i) + 1);
+                    continue;
+                }
+                i++;
+            }
+        }
+
+        uint32_t size_;
+        std::vector<segment> skyline_;
+    };
+
+    atlas_pages pack_sources(const std::vector<source_file>& sources, thread_pool* pool)
+    {
+        ZoneScopedN("pack atlas");
+        struct decoded
+        {
+            texture_data image; // one layer per animation frame
+            std::vector<uint32_t> delays_ms;
+        };
+        auto decode = [](const std::filesystem::path& path)
+        {
+            decoded result;
+            result.image = decode_frames(path, result.delays_ms);
+            return result;
+        };
+        std::vector<decoded> images(sources.size());
+        if (pool)
+        {
+            std::vector<std::future<decoded>> decoding;
+            for (const source_file& source : sources)
+            {
+                decoding.push_back(pool->submit([decode, path = source.path] { return decode(path); }));
+            }
+            for (size_t i = 0; i < sources.size(); i++)
+            {
+                images[i] = pool->wait(decoding[i]);
+            }
+        }
+        else
+        {
+            for (size_t i = 0; i < sources.size(); i++)
+            {
+                images[i] = decode(sources[i].path);
+            }
+        }
+
+        // Every frame is packed as a separate rect.
+        struct rect
+        {
+            uint32_t source;
+            uint32_t frame;
+            uint32_t layer;
+            uint32_t x;
+            uint32_t y;
+        };
+        std::vector<rect> rects;
+        uint32_t largest = 0;
+        uint64_t area = 0;
+        for (uint32_t i = 0; i < images.size(); i++)
+        {
+            texture_data& image = images[i].image;
+            if (image.levels.empty())
+            {
+                // Failed to decode: pack a single magenta pixel so the sprite is still visible.
+                image.width = image.height = image.layers = 1;
+                image.levels.push_back({ 255, 0, 255, 255 });
+                images[i].delays_ms.clear();
+            }
+            largest = std::max({ largest, image.width, image.height });
+            area += static_cast<uint64_t>(image.width + 2 * padding) * (image.height + 2 * padding) * image.layers;
+            for (uint32_t frame = 0; frame < image.layers; frame++)
+            {
+                rects.push_back({ i, frame, 0, 0, 0 });
+            }
+        }
+
+        atlas_pages pages;
+        // Big enough for the largest image and, ideally, for everything on a single page.
+        uint32_t page_size = min_page_size;
+        while (page_size < largest + 2 * padding || (page_size < max_page_size && page_size * page_size < area * 5 / 4))
+        {
+            page_size *= 2;
+        }
+
+        // Tallest first gives the skyline packer the flattest profile to work with.
+        std::vector<size_t> order(rects.size());
+        std::iota(order.begin(), order.end(), size_t{ 0 });
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b)
+        {
+            return images[rects[a].source].image.height > images[rects[b].source].image.height;
+        });
+
+        std::vector<skyline_packer> packers;
+        for (size_t i : order)
+        {
+            const texture_data& image = images[rects[i].source].image;
+            const uint32_t w = align_up(image.width + 2 * padding, rect_alignment);
+            const uint32_t h = align_up(image.height + 2 * padding, rect_alignment);
+            rect& r = rects[i];
+            while (r.layer < packers.size() && !packers[r.layer].insert(w, h, r.x, r.y))
+            {
+                r.layer++;
+            }
+            if (r.layer == packers.size())
+            {
+                packers.emplace_back(page_size).insert(w, h, r.x, r.y);
+            }
+        }
+
+        texture_data& pixels = pages.pixels;
+        pixels.width = pixels.height = page_size;
+        pixels.layers = static_cast<uint32_t>(std::max<size_t>(packers.size(), 1));
+        const size_t layer_bytes = static_cast<size_t>(page_size) * page_size * 4;
+        pixels.levels.resize(1);
+        pixels.levels[0].assign(layer_bytes * pixels.layers, 0);
+        const float page = static_cast<float>(page_size);
+        std::vector<atlas_region> frame_regions(rects.size());
+        for (size_t i = 0; i < rects.size(); i++)
+        {
+            const rect& r = rects[i];
+            const texture_data& image = images[r.source].image;
+            const auto width = static_cast<int>(image.width);
+            const auto height = static_cast<int>(image.height);
+            const unsigned char* frame = image.levels[0].data() + static_cast<size_t>(image.width) * image.height * 4 * r.frame;
+            unsigned char* layer = pixels.levels[0].data() + layer_bytes * r.layer;
+            // Copy the image and extrude its border into the padding.
+            const int pad = static_cast<int>(padding);
+            for (int y = -pad; y < height + pad; y++)
+            {
+                const int sy = std::clamp(y, 0, height - 1);
+                for (int x = -pad; x < width + pad; x++)
+                {
+                    const int sx = std::clamp(x, 0, width - 1);
+                    const size_t dst = ((r.y + pad + y) * static_cast<size_t>(page_size) + r.x + pad + x) * 4;
+                    std::memcpy(layer + dst, frame + (static_cast<size_t>(sy) * width + sx) * 4, 4);
+                }
+            }
+            atlas_region& region = frame_regions[i];
+            region.uv = { (r.x + padding) / page, (r.y + padding) / page,
+                (r.x + padding + image.width) / page, (r.y + padding + image.height) / page };
+            region.layer = r.layer;
+            region.width = image.width;
+            region.height = image.height;
+            region.clip = no_clip;
+        }
+
+        // Rects were generated source by source, frame by frame.
+        size_t first_rect = 0;
+        for (size_t i = 0; i < sources.size(); i++)
+        {
+            const uint32_t frame_count = images[i].image.layers;
+            atlas_region region = frame_regions[first_rect];
+            if (frame_count > 1)
+            {
+                region.clip = static_cast<clip_handle>(pages.clips.size());
+                atlas_clip clip = { static_cast<uint32_t>(pages.frames.size()), frame_count, 0.0f, 0 };
+                uint32_t elapsed_ms = 0;
+                for (uint32_t frame = 0; frame < frame_count; frame++)
+                {
+                    const atlas_region& source = frame_regions[first_rect + frame];
+                    elapsed_ms += images[i].delays_ms[frame];
+                    pages.frames.push_back({ source.uv, source.layer, static_cast<float>(elapsed_ms) / 1000.0f, {} });
+                }
+                clip.duration = static_cast<float>(elapsed_ms) / 1000.0f;
+                pages.clips.push_back(clip);
+            }
+            pages.names.push_back(sources[i].name);
+            pages.regions.push_back(region);
+            first_rect += frame_count;
+        }
+
+        generate_mips(pixels, mip_levels);
+        return pages;
+    }
+
+    void write_cache(const std::filesystem::path& cache_path, const std::vector<source_file>& sources, const atlas_pages& pages)
+    {
+        ZoneScopedN("write atlas cache");
+        std::ofstream out(cache_path, std::ios::binary | std::ios::trunc);
+        if (!out)
+        {
+            std::cout << "Failed to write atlas cache " << cache_path << std::endl;
+            return;
+        }
+        write_pod(out, cache_magic);
+        write_pod(out, cache_version);
+        write_pod(out, static_cast<uint32_t>(sources.size()));
+        for (const source_file& source : sources)
+        {
+            write_string(out, source.path.generic_string());
+            write_pod(out, source.size);
+            write_pod(out, source.mtime);
+            write_pod(out, hash_file(source.path));
+        }
+        write_pod(out, pages.pixels.width);
+        write_pod(out, pages.pixels.layers);
+        write_pod(out, static_cast<uint32_t>(pages.pixels.levels.size()));
+        write_pod(out, static_cast<uint32_t>(pages.regions.size()));
+        for (size_t i = 0; i < pages.regions.size(); i++)
+        {
+            write_string(out, pages.names[i]);
+            write_pod(out, pages.regions[i]);
+        }
+        write_pod(out, static_cast<uint32_t>(pages.clips.size()));
+        write_pod(out, static_cast<uint32_t>(pages.frames.size()));
+        out.write(reinterpret_cast<const char*>(pages.clips.data()), static_cast<std::streamsize>(pages.clips.size() * sizeof(atlas_clip)));
+        out.write(reinterpret_cast<const char*>(pages.frames.data()), static_cast<std::streamsize>(pages.frames.size() * sizeof(atlas_frame)));
+        for (const auto& level : pages.pixels.levels)
+        {
+            out.write(reinterpret_cast<const char*>(level.data()), static_cast<std::streamsize>(level.size()));
+        }
+    }
+
+    // Returns false if the cache is missing, corrupt or was built from different sources.
+    bool read_cache(const std::filesystem::path& cache_path, const std::vector<source_file>& sources, atlas_pages& pages, bool& timestamps_changed)
+    {
+        ZoneScopedN("read atlas cache");
+        std::ifstream in(cache_path, std::ios::binary);
+        uint32_t magic = 0;
+        uint32_t version = 0;
+        uint32_t source_count = 0;
+        if (!in || !read_pod(in, magic) || !read_pod(in, version) || !read_pod(in, source_count) ||
+            magic != cache_magic || version != cache_version || source_count != sources.size())
+        {
+            return false;
+        }
+
+        timestamps_changed = false;
+        for (const source_file& source : sources)
+        {
+            std::string path;
+            uint64_t size = 0;
+            int64_t mtime = 0;
+            uint64_t hash = 0;
+            if (!read_string(in, path) || !read_pod(in, size) || !read_pod(in, mtime) || !read_pod(in, hash) ||
+                path != source.path.generic_string())
+            {
+                return false;
+            }
+            if (size == source.size && mtime == source.mtime)
+            {
+                continue;
+            }
+            // Touched but possibly identical (e.g. re-copied by the build): fall back to the content hash.
+            if (size != source.size || hash != hash_file(source.path))
+            {
+                return false;
+            }
+            timestamps_changed = true;
+        }
+
+        texture_data& pixels = pages.pixels;
+        uint32_t level_count = 0;
+        uint32_t region_count = 0;
+        if (!read_pod(in, pixels.width) || !read_pod(in, pixels.layers) || !read_pod(in, level_count) || !read_pod(in, region_count) ||
+            !std::has_single_bit(pixels.width) || pixels.width < min_page_size || pixels.width > max_cached_page_size ||
+            pixels.layers == 0 || pixels.layers > max_cached_layers ||
+            level_count == 0 || level_count > full_mip_count(pixels.width, pixels.width) || region_count != sources.size())
+        {
+            return false;
+        }
+        pixels.height = pixels.width;
+        pages.names.resize(region_count);
+        pages.regions.resize(region_count);
+        for (uint32_t i = 0; i < region_count; i++)
+        {
+            if (!read_string(in, pages.names[i]) || !read_pod(in, pages.regions[i]))
+            {
+                return false;
+            }
+        }
+        uint32_t clip_count = 0;
+        uint32_t frame_count = 0;
+        // Every page holds at least one sprite or animation frame, except the single page of an empty atlas.
+        if (!read_pod(in, clip_count) || !read_pod(in, frame_count) || clip_count > region_count ||
+            pixels.layers > std::max<uint64_t>(uint64_t{ region_count } + frame_count, 1))
+        {
+            return false;
+        }
+        pages.clips.resize(clip_count);
+        pages.frames.resize(frame_count);
+        if (!in.read(reinterpret_cast<char*>(pages.clips.data()), static_cast<std::streamsize>(clip_count * sizeof(atlas_clip))) ||
+            !in.read(reinterpret_cast<char*>(pages.frames.data()), static_cast<std::streamsize>(frame_count * sizeof(atlas_frame))))
+        {
+            return false;
+        }
+        for (const atlas_clip& clip : pages.clips)
+        {
+            if (clip.frame_count == 0 || clip.first_frame > frame_count || clip.frame_count > frame_count - clip.first_frame)
+            {
+                return false;
+            }
+        }
+        for (const atlas_frame& frame : pages.frames)
+        {
+            if (frame.layer >= pixels.layers)
+            {
+                return false;
+            }
+        }
+        for (const atlas_region& region : pages.regions)
+        {
+            if (region.layer >= pixels.layers || (region.clip != no_clip && region.clip >= clip_count))
+            {
+                return false;
+            }
+        }
+        pixels.levels.resize(level_count);
+        for (uint32_t level = 0; level < level_count; level++)
+        {
+            const size_t size = pixels.level_bytes(level);
+            pixels.levels[level].resize(size);
+            if (!in.read(reinterpret_cast<char*>(pixels.levels[level].data()), static_cast<std::streamsize>(size)))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+atlas_pages load_atlas_pages(const std::filesystem::path& source_dir, const std::filesystem::path& cache_path, thread_pool* pool)
+{
+    ZoneScoped;
+    const std::vector<source_file> sources = scan_sources(source_dir);
+
+    atlas_pages pages;
+    bool timestamps_changed = false;
+    if (read_cache(cache_path, sources, pages, timestamps_changed))
+    {
+        if (timestamps_changed)
+        {
+            write_cache(cache_path, sources, pages);
+        }
+        return pages;
+    }
+
+    pages = pack_sources(sources, pool);
+    write_cache(cache_path, sources, pages);
+    return pages;
+}
+
+std::vector<std::string> list_atlas_sprites(const std::filesystem::path& source_dir)
+{
+    std::vector<std::string> names;
+    for (const source_file& source : scan_sources(source_dir))
+    {
+        names.push_back(source.name);
+    }
+    return names;
+}
+
+texture_atlas::texture_atlas(asset_loader& loader, const std::filesystem::path& source_dir, const std::filesystem::path& cache_path)
+    : loader_(loader), names_(list_atlas_sprites(source_dir))
+{
+    // Until the pages are resident every sprite samples the whole (placeholder) texture.
+    regions_.assign(names_.size(), atlas_region{ { 0.0f, 0.0f, 1.0f, 1.0f }, 0, 1, 1, no_clip });
+    // No sprite refers to a clip yet, but the buffers must exist to be bound. They are refilled in
+    // update() rather than recreated, so their names (and a gl_state's cached bindings) stay valid.
+    const atlas_clip no_clips = {};
+    const atlas_frame no_frames = {};
+    glCreateBuffers(1, &clip_buffer_);
+    glNamedBufferData(clip_buffer_, sizeof(no_clips), &no_clips, GL_STATIC_DRAW);
+    glCreateBuffers(1, &frame_buffer_);
+    glNamedBufferData(frame_buffer_, sizeof(no_frames), &no_frames, GL_STATIC_DRAW);
+
+    auto packed = std::make_shared<std::promise<atlas_pages>>();
+    packed_ = packed->get_future();
+    texture_ = loader_.load_texture_array([&pool = loader_.workers(), packed, source_dir, cache_path]
+    {
+        atlas_pages pages = load_atlas_pages(source_dir, cache_path, &pool);
+        texture_data pixels = std::move(pages.pixels);
+        packed->set_value(std::move(pages));
+        return pixels;
+    });
+}
+
+texture_atlas::~texture_atlas()
+{
+    glDeleteBuffers(1, &clip_buffer_);
+    glDeleteBuffers(1, &frame_buffer_);
+}
+
+void texture_atlas::bind_clips(gl_state& state) const
+{
+    state.bind_storage_buffer(clip_binding, clip_buffer_);
+    state.bind_storage_buffer(frame_binding, frame_buffer_);
+}
+
+void texture_atlas::update()
+{
+    if (!packed_.valid() || !loader_.resident(texture_))
+    {
+        return;
+    }
+    // Match by name in case the directory changed between the scan and the packing.
+    const atlas_pages pages = packed_.get();
+    for (size_t i = 0; i < pages.names.size(); i++)
+    {
+        for (size_t j = 0; j < names_.size(); j++)
+        {
+            if (names_[j] == pages.names[i])
+            {
+                regions_[j] = pages.regions[i];
+            }
+        }
+    }
+    // Uploaded once; from here on animation is driven entirely by the shader's time uniform.
+    if (!pages.clips.empty())
+    {
+        glNamedBufferData(clip_buffer_, static_cast<GLsizeiptr>(pages.clips.size() * sizeof(atlas_clip)), pages.clips.data(), GL_STATIC_DRAW);
+        glNamedBufferData(frame_buffer_, static_cast<GLsizeiptr>(pages.frames.size() * sizeof(atlas_frame)), pages.frames.data(), GL_STATIC_DRAW);
+    }
+}
+
+sprite_handle texture_atlas::find(std::string_view name) const
+{
+    for (size_t i = 0; i < names_.size(); i++)
+    {
+        if (names_[i] == name)
+        {
+            return static_cast<sprite_handle>(i);
+        }
+    }
+    throw std::runtime_error("Sprite not found in atlas: " + std::string(name));
+}
@@ -0,0 +1,109 @@
+#pragma once
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <filesystem>
+#include <future>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "asset_loader.h"
+#include "gl_state.h"
+#include "texture_data.h"
+
+// Index of a sprite inside a texture_atlas.
+using sprite_handle = uint32_t;
+
+// Index of an animation clip inside a texture_atlas.
+using clip_handle = uint32_t;
+constexpr clip_handle no_clip = UINT32_MAX;
+
+// Where a sprite lives inside the atlas. Animated sprites describe their first frame.
+struct atlas_region
+{
+    glm::vec4 uv;    // min u, min v, max u, max v
+    uint32_t layer;  // array texture layer (atlas page)
+    uint32_t width;  // source image size in pixels
+    uint32_t height;
+    clip_handle clip; // animation played by the sprite shader, or no_clip
+};
+
+// The GPU-side animation tables. Layouts must match sprite_clips.glsl (std430).
+struct atlas_clip
+{
+    uint32_t first_frame; // into atlas_pages::frames
+    uint32_t frame_count;
+    float duration;       // seconds for one loop
+    uint32_t padding;
+};
+
+struct atlas_frame
+{
+    glm::vec4 uv;
+    uint32_t layer;
+    float end; // seconds from the start of the clip at which the next frame is shown
+    uint32_t padding[2];
+};
+
+static_assert(sizeof(atlas_clip) == 16 && sizeof(atlas_frame) == 32, "std430 array strides");
+
+// CPU-side atlas as produced by the packer or read back from the cache file.
+struct atlas_pages
+{
+    texture_data pixels; // square pages, one array layer each, with mip levels
+    std::vector<std::string> names; // file stem of each region's source image
+    std::vector<atlas_region> regions;
+    std::vector<atlas_clip> clips;   // one per animated source image (a GIF with several frames)
+    std::vector<atlas_frame> frames;
+};
+
+// Packs every image under source_dir into array texture pages. The result is written to cache_path
+// and reused on later runs as long as the source files are unchanged, so a warm start decodes nothing.
+// On a cache miss the images are decoded in parallel on `pool` when one is given.
+atlas_pages load_atlas_pages(const std::filesystem::path& source_dir, const std::filesystem::path& cache_path, thread_pool* pool = nullptr);
+
+// Sprite names in the order load_atlas_pages() emits their regions.
+std::vector<std::string> list_atlas_sprites(const std::filesystem::path& source_dir);
+
+// GL_TEXTURE_2D_ARRAY holding the packed pages. Every sprite samples the same texture, so sprites
+// using different images can still be drawn together. Loading and uploading happen through the
+// asset_loader; sprite handles are valid immediately and resolve to the placeholder until then.
+//
+// Every frame of an animated GIF is packed as its own region. The frame tables live in two storage
+// buffers and the sprite vertex shader picks the frame from its `time` uniform, so animating any
+// number of sprites costs no texture uploads and no CPU work.
+class texture_atlas
+{
+public:
+    // Storage buffer binding points of the clip and frame tables.
+    static constexpr GLuint clip_binding = 0;
+    static constexpr GLuint frame_binding = 1;
+
+    texture_atlas(asset_loader& loader, const std::filesystem::path& source_dir, const std::filesystem::path& cache_path);
+    ~texture_atlas();
+
+    texture_atlas(const texture_atlas&) = delete;
+    texture_atlas& operator=(const texture_atlas&) = delete;
+
+    GLuint texture() const { return loader_.texture(texture_); }
+    // Binds the animation tables for the sprite shader. Valid (if empty) before the atlas is resident.
+    void bind_clips(gl_state& state) const;
+    bool resident() const { return !packed_.valid(); }
+    // Looks a sprite up by the file stem of its source image, e.g. "red_wizard".
+    sprite_handle find(std::string_view name) const;
+    // Name of every sprite, indexed by handle.
+    const std::vector<std::string>& names() const { return names_; }
+    const atlas_region& region(sprite_handle handle) const { return regions_[handle]; }
+
+    // Swaps in the packed regions once the pages are resident. Call once per frame after asset_loader::update().
+    void update();
+
+private:
+    asset_loader& loader_;
+    texture_handle texture_ = 0;
+    std::future<atlas_pages> packed_;
+    std::vector<std::string> names_;
+    std::vector<atlas_region> regions_;
+    GLuint clip_buffer_ = 0;
+    GLuint frame_buffer_ = 0;
+};
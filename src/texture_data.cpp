@@ -0,0 +1,127 @@
+#include "texture_data.h"
+#include <tracy/Tracy.hpp>
+#include <stb_image.h>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+
+uint32_t full_mip_count(uint32_t width, uint32_t height)
+{
+    uint32_t levels = 1;
+    while ((width | height) >> levels)
+    {
+        levels++;
+    }
+    return levels;
+}
+
+texture_data decode_image(const std::filesystem::path& path)
+{
+    ZoneScopedN("decode image");
+    const std::string name = path.string();
+    ZoneText(name.c_str(), name.size());
+
+    texture_data data;
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    stbi_uc* pixels = stbi_load(name.c_str(), &width, &height, &channels, 4);
+    if (!pixels)
+    {
+        std::cout << "Failed to load texture " << path << ": " << stbi_failure_reason() << std::endl;
+        return data;
+    }
+    data.width = static_cast<uint32_t>(width);
+    data.height = static_cast<uint32_t>(height);
+    data.levels.emplace_back(pixels, pixels + static_cast<size_t>(width) * height * 4);
+    stbi_image_free(pixels);
+    return data;
+}
+
+texture_data decode_frames(const std::filesystem::path& path, std::vector<uint32_t>& frame_delays_ms)
+{
+    frame_delays_ms.clear();
+    std::string ext = path.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    if (ext != ".gif")
+    {
+        return decode_image(path);
+    }
+
+    ZoneScopedN("decode gif");
+    const std::string name = path.string();
+    ZoneText(name.c_str(), name.size());
+
+    // stb_image only decodes every frame of a GIF from memory.
+    std::ifstream file(path, std::ios::binary);
+    const std::vector<char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    texture_data data;
+    int width = 0;
+    int height = 0;
+    int frames = 0;
+    int channels = 0;
+    int* delays = nullptr;
+    stbi_uc* pixels = stbi_load_gif_from_memory(reinterpret_cast<const stbi_uc*>(bytes.data()), static_cast<int>(bytes.size()), &delays,
+        &width, &height, &frames, &channels, 4);
+    if (!pixels)
+    {
+        std::cout << "Failed to load texture " << path << ": " << stbi_failure_reason() << std::endl;
+        return data;
+    }
+    // Frames come back composited and stacked top to bottom, which is exactly the layer layout.
+    data.width = static_cast<uint32_t>(width);
+    data.height = static_cast<uint32_t>(height);
+    data.layers = static_cast<uint32_t>(frames);
+    data.levels.emplace_back(pixels, pixels + static_cast<size_t>(width) * height * 4 * frames);
+    for (int i = 0; i < frames; i++)
+    {
+        // Like browsers, treat the (very common) 0 and 10 ms delays as 100 ms.
+        const int delay = delays ? delays[i] : 0;
+        frame_delays_ms.push_back(delay <= 10 ? 100u : static_cast<uint32_t>(delay));
+    }
+    stbi_image_free(delays);
+    stbi_image_free(pixels);
+    return data;
+}
+
+void generate_mips(texture_data& data, uint32_t level_count)
+{
+    ZoneScoped;
+    data.levels.resize(level_count);
+    for (uint32_t level = 1; level < level_count; level++)
+    {
+        const uint32_t src_w = data.level_width(level - 1);
+        const uint32_t src_h = data.level_height(level - 1);
+        const uint32_t dst_w = data.level_width(level);
+        const uint32_t dst_h = data.level_height(level);
+        const std::vector<unsigned char>& src = data.levels[level - 1];
+        std::vector<unsigned char>& dst = data.levels[level];
+        dst.resize(data.level_bytes(level));
+        for (uint32_t layer = 0; layer < data.layers; layer++)
+        {
+            const unsigned char* s = src.data() + static_cast<size_t>(layer) * src_w * src_h * 4;
+            unsigned char* d = dst.data() + static_cast<size_t>(layer) * dst_w * dst_h * 4;
+            for (uint32_t y = 0; y < dst_h; y++)
+            {
+                // Odd sizes clamp to the last row/column instead of reading past the level.
+                const size_t y0 = std::min(y * 2, src_h - 1);
+                const size_t y1 = std::min(y * 2 + 1, src_h - 1);
+                for (uint32_t x = 0; x < dst_w; x++)
+                {
+                    const size_t x0 = std::min(x * 2, src_w - 1);
+                    const size_t x1 = std::min(x * 2 + 1, src_w - 1);
+                    for (size_t c = 0; c < 4; c++)
+                    {
+                        const uint32_t sum = s[(y0 * src_w + x0) * 4 + c] + s[(y0 * src_w + x1) * 4 + c] +
+                            s[(y1 * src_w + x0) * 4 + c] + s[(y1 * src_w + x1) * 4 + c];
+                        d[(static_cast<size_t>(y) * dst_w + x) * 4 + c] = static_cast<unsigned char>((sum + 2) / 4);
+                    }
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+// CPU-side RGBA8 pixels of a 2D texture or 2D array texture, including every mip level.
+struct texture_data
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t layers = 1;
+    std::vector<std::vector<unsigned char>> levels; // each level holds all layers back to back
+
+    size_t level_bytes(uint32_t level) const
+    {
+        return static_cast<size_t>(level_width(level)) * level_height(level) * 4 * layers;
+    }
+    uint32_t level_width(uint32_t level) const { return width >> level > 0 ? width >> level : 1; }
+    uint32_t level_height(uint32_t level) const { return height >> level > 0 ? height >> level : 1; }
+};
+
+// Number of levels in a full mip chain for the given size.
+uint32_t full_mip_count(uint32_t width, uint32_t height);
+
+// Decodes an image with stb_image into a single level, single layer texture_data.
+// Returns an empty texture_data (no levels) if the file could not be decoded.
+texture_data decode_image(const std::filesystem::path& path);
+
+// Like decode_image(), but every frame of an animated GIF becomes one layer and its display time in
+// milliseconds is stored in `frame_delays_ms`. Still images decode to a single layer with no delays.
+texture_data decode_frames(const std::filesystem::path& path, std::vector<uint32_t>& frame_delays_ms);
+
+// Box-filters level 0 down into `level_count` levels (including level 0).
+void generate_mips(texture_data& data, uint32_t level_count);
@@ -0,0 +1,60 @@
+#include "thread_pool.h"
+#include <tracy/Tracy.hpp>
+
+thread_pool::thread_pool(unsigned thread_count, const char* name)
+{
+    for (unsigned i = 0; i < thread_count; i++)
+    {
+        threads_.emplace_back([this, name] { worker_loop(name); });
+    }
+}
+
+thread_pool::~thread_pool()
+{
+    {
+        std::lock_guard lock(mutex_);
+        stopping_ = true;
+        tasks_.clear();
+    }
+    wake_.notify_all();
+    for (std::thread& thread : threads_)
+    {
+        thread.join();
+    }
+}
+
+bool thread_pool::run_one()
+{
+    std::function<void()> task;
+    {
+        std::lock_guard lock(mutex_);
+        if (tasks_.empty())
+        {
+            return false;
+        }
+        task = std::move(tasks_.front());
+        tasks_.pop_front();
+    }
+    task();
+    return true;
+}
+
+void thread_pool::worker_loop(const char* name)
+{
+    tracy::SetThreadName(name);
+    for (;;)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock lock(mutex_);
+            wake_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+            if (stopping_)
+            {
+                return;
+            }
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+        task();
+    }
+}
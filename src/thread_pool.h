@@ -0,0 +1,62 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Fixed set of worker threads consuming a FIFO of tasks. Used for blocking work such as file IO and
+// image decoding that should never stall the render thread.
+class thread_pool
+{
+public:
+    thread_pool(unsigned thread_count, const char* name);
+    ~thread_pool();
+
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+
+    template<typename F>
+    auto submit(F&& f) -> std::future<std::invoke_result_t<F>>
+    {
+        using result = std::invoke_result_t<F>;
+        auto task = std::make_shared<std::packaged_task<result()>>(std::forward<F>(f));
+        std::future<result> future = task->get_future();
+        {
+            std::lock_guard lock(mutex_);
+            tasks_.emplace_back([task] { (*task)(); });
+        }
+        wake_.notify_one();
+        return future;
+    }
+
+    // Runs queued tasks on the calling thread until `future` is ready, so a task may wait on tasks it
+    // submitted itself without deadlocking the pool.
+    template<typename T>
+    T wait(std::future<T>& future)
+    {
+        while (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        {
+            if (!run_one())
+            {
+                future.wait_for(std::chrono::microseconds(100));
+            }
+        }
+        return future.get();
+    }
+
+private:
+    bool run_one();
+    void worker_loop(const char* name);
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::deque<std::function<void()>> tasks_;
+    std::vector<std::thread> threads_;
+    bool stopping_ = false;
+};
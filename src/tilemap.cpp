@@ -0,0 +1,134 @@
+#include "tilemap.h"
+#include <tracy/Tracy.hpp>
+#include <algorithm>
+#include <cmath>
+
+tilemap::tilemap(const sprite_pipeline& pipeline, uint32_t width, uint32_t height, float tile_size)
+    : width_(width), height_(height), tile_size_(tile_size)
+{
+    chunks_x_ = (width_ + chunk_size - 1) / chunk_size;
+    chunks_y_ = (height_ + chunk_size - 1) / chunk_size;
+    tiles_.assign(static_cast<size_t>(width_) * height_, empty_tile);
+    chunks_.resize(static_cast<size_t>(chunks_x_) * chunks_y_);
+    scratch_.reserve(chunk_tiles);
+
+    const GLsizeiptr size = static_cast<GLsizeiptr>(sizeof(sprite_instance)) * chunk_tiles * chunks_.size();
+    glCreateBuffers(1, &buffer_);
+    glNamedBufferStorage(buffer_, size, nullptr, GL_DYNAMIC_STORAGE_BIT);
+    vao_ = create_quad_vao(pipeline);
+    bind_sprite_instances(vao_, buffer_);
+}
+
+tilemap::~tilemap()
+{
+    glDeleteVertexArrays(1, &vao_);
+    glDeleteBuffers(1, &buffer_);
+}
+
+void tilemap::set_tile(uint32_t x, uint32_t y, sprite_handle tile)
+{
+    sprite_handle& current = tiles_[y * width_ + x];
+    if (current != tile)
+    {
+        current = tile;
+        chunks_[(y / chunk_size) * chunks_x_ + x / chunk_size].dirty = true;
+    }
+}
+
+void tilemap::clear()
+{
+    std::fill(tiles_.begin(), tiles_.end(), empty_tile);
+    for (chunk& c : chunks_)
+    {
+        c.dirty = true;
+    }
+}
+
+void tilemap::bake(uint32_t chunk_x, uint32_t chunk_y, const texture_atlas& atlas)
+{
+    ZoneScopedN("tilemap bake");
+    scratch_.clear();
+    const uint32_t x0 = chunk_x * chunk_size, x1 = std::min(x0 + chunk_size, width_);
+    const uint32_t y0 = chunk_y * chunk_size, y1 = std::min(y0 + chunk_size, height_);
+    const glm::vec2 size(tile_size_);
+    for (uint32_t y = y0; y < y1; y++)
+    {
+        for (uint32_t x = x0; x < x1; x++)
+        {
+            const sprite_handle tile = tiles_[y * width_ + x];
+            if (tile == empty_tile)
+            {
+                continue;
+            }
+            const atlas_region& region = atlas.region(tile);
+            // Animated tiles all play in step.
+            scratch_.push_back({ (glm::vec2(x, y) + 0.5f) * tile_size_, size, region.uv, region.layer, region.clip, 0.0f, 1.0f });
+        }
+    }
+
+    const uint32_t index = chunk_y * chunks_x_ + chunk_x;
+    chunk& c = chunks_[index];
+    c.count = static_cast<uint32_t>(scratch_.size());
+    c.dirty = false;
+    if (c.count > 0)
+    {
+        const GLintptr offset = static_cast<GLintptr>(sizeof(sprite_instance)) * chunk_tiles * index;
+        glNamedBufferSubData(buffer_, offset, static_cast<GLsizeiptr>(sizeof(sprite_instance) * c.count), scratch_.data());
+        stats_.bytes_uploaded += sizeof(sprite_instance) * c.count;
+    }
+}
+
+const tilemap_stats& tilemap::draw(render_queue& queue, GLuint program, const texture_atlas& atlas, const aabb& view)
+{
+    ZoneScopedN("tilemap draw");
+    stats_ = {};
+    if (atlas.resident() != baked_resident_)
+    {
+        baked_resident_ = atlas.resident();
+        for (chunk& c : chunks_)
+        {
+            c.dirty = true;
+        }
+    }
+
+    const aabb map = bounds();
+    if (chunks_.empty() || !overlaps(view, map))
+    {
+        return stats_;
+    }
+    // Chunks overlapping the view, clamped to the map.
+    const float chunk_extent = tile_size_ * chunk_size;
+    auto chunk_of = [chunk_extent](float coordinate, uint32_t count)
+    {
+        const float index = std::floor(coordinate / chunk_extent);
+        return static_cast<uint32_t>(std::clamp(index, 0.0f, static_cast<float>(count - 1)));
+    };
+    const uint32_t cx0 = chunk_of(view.min.x, chunks_x_), cx1 = chunk_of(view.max.x, chunks_x_);
+    const uint32_t cy0 = chunk_of(view.min.y, chunks_y_), cy1 = chunk_of(view.max.y, chunks_y_);
+
+    const GLuint texture = atlas.texture();
+    for (uint32_t cy = cy0; cy <= cy1; cy++)
+    {
+        for (uint32_t cx = cx0; cx <= cx1; cx++)
+        {
+            const uint32_t index = cy * chunks_x_ + cx;
+            if (chunks_[index].dirty)
+            {
+                bake(cx, cy, atlas);
+                stats_.baked_chunks++;
+            }
+            const uint32_t count = chunks_[index].count;
+            if (count == 0)
+            {
+                continue;
+            }
+            queue.push(render_layer::terrain, 0, { program, vao_, texture, 6, 0, count, index * chunk_tiles });
+            stats_.visible_chunks++;
+            stats_.tiles += count;
+        }
+    }
+
+    TracyPlot("tilemap chunks drawn", static_cast<int64_t>(stats_.visible_chunks));
+    TracyPlot("tilemap chunks baked", static_cast<int64_t>(stats_.baked_chunks));
+    return stats_;
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <glad/gl.h>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "render_queue.h"
+#include "spatial_hash.h"
+#include "sprite_batch.h"
+#include "sprite_pipeline.h"
+#include "texture_atlas.h"
+
+struct tilemap_stats
+{
+    uint32_t visible_chunks; // chunks overlapping the view that contain tiles
+    uint32_t baked_chunks;   // chunks rebuilt this frame
+    uint32_t tiles;          // tiles drawn
+    uint64_t bytes_uploaded; // by rebaking
+};
+
+// Static terrain: a grid of atlas sprites split into chunk_size x chunk_size chunks. Each chunk owns
+// a fixed slot in one static instance buffer and is baked into it only when its tiles change, so a
+// frame with no edits uploads nothing. draw() queues one instanced draw per chunk overlapping the
+// view, so the cost follows what is on screen rather than the size of the map. The chunks share
+// all their state, so the render queue merges them into a single multi-draw.
+class tilemap
+{
+public:
+    static constexpr uint32_t chunk_size = 32;
+    static constexpr uint32_t chunk_tiles = chunk_size * chunk_size;
+    static constexpr sprite_handle empty_tile = UINT32_MAX;
+
+    // Tile (0, 0) has its top left corner at the world origin.
+    tilemap(const sprite_pipeline& pipeline, uint32_t width, uint32_t height, float tile_size);
+    ~tilemap();
+
+    tilemap(const tilemap&) = delete;
+    tilemap& operator=(const tilemap&) = delete;
+
+    uint32_t width() const { return width_; }
+    uint32_t height() const { return height_; }
+    float tile_size() const { return tile_size_; }
+    aabb bounds() const { return { { 0.0f, 0.0f }, glm::vec2(width_, height_) * tile_size_ }; }
+
+    sprite_handle tile(uint32_t x, uint32_t y) const { return tiles_[y * width_ + x]; }
+    // Every tile, row by row.
+    std::span<const sprite_handle> tiles() const { return tiles_; }
+    void set_tile(uint32_t x, uint32_t y, sprite_handle tile);
+    void clear();
+
+    // Rebakes the dirty chunks in view and pushes a draw for every chunk overlapping `view` to
+    // `queue`, on the terrain layer. `program` is the sprite program.
+    const tilemap_stats& draw(render_queue& queue, GLuint program, const texture_atlas& atlas, const aabb& view);
+    const tilemap_stats& stats() const { return stats_; }
+
+private:
+    struct chunk
+    {
+        uint32_t count = 0; // baked instances at the start of the chunk's slot
+        bool dirty = true;
+    };
+
+    void bake(uint32_t chunk_x, uint32_t chunk_y, const texture_atlas& atlas);
+
+    uint32_t width_ = 0;
+    uint32_t height_ = 0;
+    float tile_size_ = 0.0f;
+    uint32_t chunks_x_ = 0;
+    uint32_t chunks_y_ = 0;
+    std::vector<sprite_handle> tiles_;
+    std::vector<chunk> chunks_;
+    std::vector<sprite_instance> scratch_; // one chunk's instances while baking
+
+    GLuint vao_ = 0;
+    GLuint buffer_ = 0;
+    // Atlas regions change once the atlas becomes resident, which invalidates every baked chunk.
+    bool baked_resident_ = false;
+    tilemap_stats stats_ = {};
+};